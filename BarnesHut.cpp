@@ -0,0 +1,303 @@
+#include "BarnesHut.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Morton codes interleave 21 bits per axis, so the octree is at most 21 levels deep
+static constexpr int maximumLevel = 21;
+
+static std::uint64_t spreadBits(std::uint64_t v)
+{
+	v &= 0x1fffff;
+	v = (v | v << 32) & 0x1f00000000ffff;
+	v = (v | v << 16) & 0x1f0000ff0000ff;
+	v = (v | v << 8) & 0x100f00f00f00f00f;
+	v = (v | v << 4) & 0x10c30c30c30c30c3;
+	v = (v | v << 2) & 0x1249249249249249;
+	return v;
+}
+
+BarnesHutGravity::BarnesHutGravity(double gravitationalConstant, double softening, double openingAngle, int leafSize)
+	: GravitySolver{gravitationalConstant, softening}
+	, theta{openingAngle}
+	, leafSize{std::max(leafSize, 1)}
+	, rootSize{0}
+{}
+
+double BarnesHutGravity::openingAngle() const
+{
+	return this->theta;
+}
+
+void BarnesHutGravity::setOpeningAngle(double theta)
+{
+	this->theta = theta;
+}
+
+void BarnesHutGravity::computeAccelerations(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & mass, Eigen::ArrayX3d & acceleration)
+{
+	auto n = static_cast<std::ptrdiff_t>(position.rows());
+	acceleration.resize(n, 3);
+	if(n == 0)
+		return;
+
+	this->sortBodies(position, mass);
+	this->buildTree();
+
+	auto theta2 = this->theta * this->theta;
+	auto epsilon2 = this->epsilon * this->epsilon;
+	auto nodeCount = static_cast<std::uint32_t>(this->nodes.size());
+
+	this->sortedAcceleration.resize(n, 3);
+	parallelFor(0, n, 64, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		auto const & p = this->sortedPosition;
+		auto const & m = this->sortedMass;
+
+		for(auto i = static_cast<std::uint32_t>(first); i < last; ++i)
+		{
+			auto px = p(i, 0), py = p(i, 1), pz = p(i, 2);
+			double ax = 0, ay = 0, az = 0;
+
+			for(std::uint32_t index = 0; index < nodeCount;)
+			{
+				auto const & node = this->nodes[index];
+
+				if(node.leaf)
+				{
+					for(auto k = node.begin; k < node.end; ++k)
+					{
+						if(k == i)
+							continue;
+
+						auto dx = p(k, 0) - px, dy = p(k, 1) - py, dz = p(k, 2) - pz;
+						auto r2 = dx * dx + dy * dy + dz * dz + epsilon2;
+						auto w = m(k) / (r2 * std::sqrt(r2));
+						ax += w * dx;
+						ay += w * dy;
+						az += w * dz;
+					}
+					index = node.next;
+					continue;
+				}
+
+				auto dx = node.x - px, dy = node.y - py, dz = node.z - pz;
+				auto d2 = dx * dx + dy * dy + dz * dz;
+
+				// never approximate a cell by its center of mass if the body itself is part of it
+				if((i < node.begin || i >= node.end) && node.size * node.size < theta2 * d2)
+				{
+					auto r2 = d2 + epsilon2;
+					auto w = node.mass / (r2 * std::sqrt(r2));
+					ax += w * dx;
+					ay += w * dy;
+					az += w * dz;
+					index = node.next;
+				}
+				else
+					++index;
+			}
+
+			this->sortedAcceleration.row(i) << ax, ay, az;
+		}
+	});
+
+	parallelFor(0, n, 4096, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		for(auto k = first; k < last; ++k)
+			acceleration.row(this->codes[k].second) = this->G * this->sortedAcceleration.row(k);
+	});
+}
+
+void BarnesHutGravity::sortBodies(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & mass)
+{
+	auto n = static_cast<std::ptrdiff_t>(position.rows());
+
+	Eigen::Array3d lower = position.colwise().minCoeff();
+	Eigen::Array3d upper = position.colwise().maxCoeff();
+	this->rootSize = std::max((upper - lower).maxCoeff(), std::numeric_limits<double>::min());
+	auto scale = ((1 << maximumLevel) - 1) / this->rootSize;
+
+	this->codes.resize(n);
+	parallelFor(0, n, 4096, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		for(auto k = first; k < last; ++k)
+		{
+			std::uint64_t code = 0;
+			for(int c = 0; c < 3; ++c)
+				code |= spreadBits(static_cast<std::uint64_t>((position(k, c) - lower(c)) * scale)) << (2 - c);
+			this->codes[k] = {code, static_cast<std::uint32_t>(k)};
+		}
+	});
+
+	// sort chunks in parallel, then merge neighbouring runs pairwise; the pairs are unique, so the order does not depend on the chunks
+	auto chunks = static_cast<std::ptrdiff_t>(std::min<std::ptrdiff_t>(workerCount(), std::max<std::ptrdiff_t>(n / 4096, 1)));
+	auto bound = [&] (std::ptrdiff_t c) { return this->codes.begin() + n * std::min(c, chunks) / chunks; };
+	parallelFor(0, chunks, 1, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		for(auto c = first; c < last; ++c)
+			std::sort(bound(c), bound(c + 1));
+	});
+	for(std::ptrdiff_t width = 1; width < chunks; width *= 2)
+	{
+		parallelFor(0, (chunks + 2 * width - 1) / (2 * width), 1, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+			for(auto k = first; k < last; ++k)
+				std::inplace_merge(bound(2 * k * width), bound((2 * k + 1) * width), bound((2 * k + 2) * width));
+		});
+	}
+
+	this->sortedPosition.resize(n, 3);
+	this->sortedMass.resize(n);
+	parallelFor(0, n, 4096, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		for(auto k = first; k < last; ++k)
+		{
+			this->sortedPosition.row(k) = position.row(this->codes[k].second);
+			this->sortedMass(k) = mass(this->codes[k].second);
+		}
+	});
+}
+
+void BarnesHutGravity::buildTree()
+{
+	auto n = static_cast<std::uint32_t>(this->codes.size());
+	this->nodes.clear();
+
+	// the top of the tree is split serially until the remaining subtrees are small enough to balance across the workers
+	// grain only decides where that happens, the nodes and the order their children are summed in are the same for any worker count
+	auto grain = std::max<std::uint32_t>(this->leafSize, n / (8 * workerCount()));
+
+	std::vector<Subtree> subtrees;
+	this->collectSubtrees(0, 0, n, grain, subtrees);
+
+	std::vector<std::vector<Node>> built(subtrees.size());
+	parallelFor(0, subtrees.size(), 1, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		for(auto s = first; s < last; ++s)
+			this->buildSubtree(built[s], subtrees[s].level, subtrees[s].begin, subtrees[s].end);
+	});
+
+	std::size_t nextSubtree = 0;
+	this->assemble(0, 0, n, grain, built, nextSubtree);
+}
+
+void BarnesHutGravity::splitOctants(int level, std::uint32_t begin, std::uint32_t end, std::uint32_t (& bounds)[9]) const
+{
+	// all codes in the range share the prefix above this level, so the octant is monotonic in Morton order
+	auto shift = 3 * (maximumLevel - 1 - level);
+	auto first = this->codes.begin() + begin;
+	auto last = this->codes.begin() + end;
+
+	bounds[0] = begin;
+	for(std::uint64_t octant = 1; octant < 8; ++octant)
+	{
+		first = std::partition_point(first, last, [&] (std::pair<std::uint64_t, std::uint32_t> const & code) {
+			return (code.first >> shift & 7) < octant;
+		});
+		bounds[octant] = static_cast<std::uint32_t>(first - this->codes.begin());
+	}
+	bounds[8] = end;
+}
+
+bool BarnesHutGravity::isLeaf(int level, std::uint32_t begin, std::uint32_t end) const
+{
+	return end - begin <= static_cast<std::uint32_t>(this->leafSize) || level == maximumLevel;
+}
+
+void BarnesHutGravity::collectSubtrees(int level, std::uint32_t begin, std::uint32_t end, std::uint32_t grain, std::vector<Subtree> & subtrees) const
+{
+	if(end - begin <= grain || this->isLeaf(level, begin, end))
+	{
+		subtrees.push_back({level, begin, end});
+		return;
+	}
+
+	std::uint32_t bounds[9];
+	this->splitOctants(level, begin, end, bounds);
+	for(int octant = 0; octant < 8; ++octant)
+		if(bounds[octant] < bounds[octant + 1])
+			this->collectSubtrees(level + 1, bounds[octant], bounds[octant + 1], grain, subtrees);
+}
+
+void BarnesHutGravity::buildSubtree(std::vector<Node> & nodes, int level, std::uint32_t begin, std::uint32_t end) const
+{
+	auto index = nodes.size();
+	nodes.emplace_back();
+
+	if(!this->isLeaf(level, begin, end))
+	{
+		std::uint32_t bounds[9];
+		this->splitOctants(level, begin, end, bounds);
+		for(int octant = 0; octant < 8; ++octant)
+			if(bounds[octant] < bounds[octant + 1])
+				this->buildSubtree(nodes, level + 1, bounds[octant], bounds[octant + 1]);
+	}
+
+	this->finishNode(nodes, index, level, begin, end);
+}
+
+void BarnesHutGravity::assemble(int level, std::uint32_t begin, std::uint32_t end, std::uint32_t grain, std::vector<std::vector<Node>> & built, std::size_t & nextSubtree)
+{
+	// mirrors collectSubtrees, so the prebuilt subtrees are consumed in the order they were collected
+	if(end - begin <= grain || this->isLeaf(level, begin, end))
+	{
+		auto offset = static_cast<std::uint32_t>(this->nodes.size());
+		for(auto & node : built[nextSubtree++])
+		{
+			node.next += offset;
+			this->nodes.push_back(node);
+		}
+		return;
+	}
+
+	auto index = this->nodes.size();
+	this->nodes.emplace_back();
+
+	std::uint32_t bounds[9];
+	this->splitOctants(level, begin, end, bounds);
+	for(int octant = 0; octant < 8; ++octant)
+		if(bounds[octant] < bounds[octant + 1])
+			this->assemble(level + 1, bounds[octant], bounds[octant + 1], grain, built, nextSubtree);
+
+	this->finishNode(this->nodes, index, level, begin, end);
+}
+
+void BarnesHutGravity::finishNode(std::vector<Node> & nodes, std::size_t index, int level, std::uint32_t begin, std::uint32_t end) const
+{
+	Node node;
+	node.size = std::ldexp(this->rootSize, -level);
+	node.begin = begin;
+	node.end = end;
+	node.next = static_cast<std::uint32_t>(nodes.size());
+	node.leaf = this->isLeaf(level, begin, end);
+
+	double m = 0;
+	Eigen::Array3d weighted = Eigen::Array3d::Zero();
+	Eigen::Array3d unweighted = Eigen::Array3d::Zero();
+	if(node.leaf)
+	{
+		for(auto k = begin; k < end; ++k)
+		{
+			Eigen::Array3d p = this->sortedPosition.row(k);
+			m += this->sortedMass(k);
+			weighted += this->sortedMass(k) * p;
+			unweighted += p;
+		}
+	}
+	else
+	{
+		for(auto child = index + 1; child < nodes.size(); child = nodes[child].next)
+		{
+			auto const & c = nodes[child];
+			Eigen::Array3d p{c.x, c.y, c.z};
+			m += c.mass;
+			weighted += c.mass * p;
+			unweighted += static_cast<double>(c.end - c.begin) * p;
+		}
+	}
+
+	// massless cells (test particles only) fall back to their geometric center so distances stay meaningful
+	Eigen::Array3d center = m > 0 ? Eigen::Array3d(weighted / m) : Eigen::Array3d(unweighted / (end - begin));
+	node.x = center.x();
+	node.y = center.y();
+	node.z = center.z();
+	node.mass = m;
+
+	nodes[index] = node;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Gravity.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// O(N log N) approximation: bodies are sorted along a Morton curve and a linear octree is rebuilt every call,
+// stored in pre-order in one contiguous array so that both the build and the traversal are cache friendly
+class BarnesHutGravity : public GravitySolver
+{
+public:
+	BarnesHutGravity(double gravitationalConstant = 1, double softening = 0, double openingAngle = 0.5, int leafSize = 8);
+
+	// a cell of edge length s at distance d is approximated by its center of mass if s / d < openingAngle, 0 degenerates to the exact sum
+	double openingAngle() const;
+	void setOpeningAngle(double theta);
+
+	void computeAccelerations(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & mass, Eigen::ArrayX3d & acceleration) override;
+
+private:
+	struct Node
+	{
+		double x, y, z, mass;
+		double size;
+		// range of bodies in Morton order
+		std::uint32_t begin, end;
+		// pre-order index of the next node outside this subtree
+		std::uint32_t next;
+		bool leaf;
+	};
+
+	struct Subtree
+	{
+		int level;
+		std::uint32_t begin, end;
+	};
+
+	void sortBodies(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & mass);
+	void buildTree();
+
+	void splitOctants(int level, std::uint32_t begin, std::uint32_t end, std::uint32_t (& bounds)[9]) const;
+	bool isLeaf(int level, std::uint32_t begin, std::uint32_t end) const;
+	void collectSubtrees(int level, std::uint32_t begin, std::uint32_t end, std::uint32_t grain, std::vector<Subtree> & subtrees) const;
+	void buildSubtree(std::vector<Node> & nodes, int level, std::uint32_t begin, std::uint32_t end) const;
+	void assemble(int level, std::uint32_t begin, std::uint32_t end, std::uint32_t grain, std::vector<std::vector<Node>> & built, std::size_t & nextSubtree);
+	void finishNode(std::vector<Node> & nodes, std::size_t index, int level, std::uint32_t begin, std::uint32_t end) const;
+
+	double theta;
+	int leafSize;
+
+	double rootSize;
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> codes;
+	Eigen::ArrayX3d sortedPosition, sortedAcceleration;
+	Eigen::ArrayXd sortedMass;
+	std::vector<Node> nodes;
+};
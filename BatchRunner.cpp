@@ -0,0 +1,318 @@
+#include "BatchRunner.hpp"
+#include "Integrators.hpp"
+#include "Parallel.hpp"
+#include "Simulation.hpp"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <vector>
+
+struct BatchResult
+{
+	double initialEnergy, finalEnergy;
+	// kinetic plus the magnitude of the potential energy at the start, the scale E0 is compared to
+	double energyMagnitude;
+	// largest |E - E0| over all samples
+	double maximumEnergyError;
+	// smallest center distance of any pair over all samples, and when and between which bodies it occurred
+	double minimumDistance, minimumDistanceTime;
+	Eigen::Index closestFirst, closestSecond;
+	BodyState final;
+};
+
+static bool readVector(QJsonValue const & value, double (& vector)[3])
+{
+	auto array = value.toArray();
+	if(array.size() != 3)
+		return false;
+	for(int c = 0; c < 3; ++c)
+	{
+		if(!array.at(c).isDouble())
+			return false;
+		vector[c] = array.at(c).toDouble();
+	}
+	return true;
+}
+
+// a missing value keeps the default, a present one has to be an integral number in [minimum, maximum] so the cast is exact
+static bool readInteger(QJsonValue const & value, double minimum, double maximum, double & result)
+{
+	if(value.isUndefined())
+		return true;
+	if(!value.isDouble())
+		return false;
+	auto number = value.toDouble();
+	if(!std::isfinite(number) || number != std::floor(number) || number < minimum || number > maximum)
+		return false;
+	result = number;
+	return true;
+}
+
+bool loadBatchScenario(QString const & path, BatchScenario & scenario, QString & error)
+{
+	QFile file{path};
+	if(!file.open(QIODevice::ReadOnly))
+	{
+		error = QString{"Could not open %1"}.arg(path);
+		return false;
+	}
+
+	QJsonParseError parseError;
+	auto document = QJsonDocument::fromJson(file.readAll(), &parseError);
+	if(!document.isObject())
+	{
+		error = QString{"%1 is not a JSON object: %2"}.arg(path, parseError.errorString());
+		return false;
+	}
+	auto root = document.object();
+
+	scenario.runs = root.value("runs").toInt(scenario.runs);
+	// larger step counts are not exact as JSON numbers
+	auto steps = static_cast<double>(scenario.steps);
+	if(!readInteger(root.value("steps"), 1, 9007199254740992., steps))
+	{
+		error = "steps has to be a positive integer of at most 2^53";
+		return false;
+	}
+	scenario.steps = static_cast<std::int64_t>(steps);
+	scenario.timeStep = root.value("timeStep").toDouble(scenario.timeStep);
+	auto seed = static_cast<double>(scenario.seed);
+	if(!readInteger(root.value("seed"), 0, std::numeric_limits<std::uint32_t>::max(), seed))
+	{
+		error = "seed has to be an integer from 0 to 2^32 - 1";
+		return false;
+	}
+	scenario.seed = static_cast<std::uint32_t>(seed);
+	scenario.integrator = root.value("integrator").toString(QString::fromStdString(scenario.integrator)).toStdString();
+	scenario.gravitationalConstant = root.value("gravitationalConstant").toDouble(scenario.gravitationalConstant);
+	scenario.softening = root.value("softening").toDouble(scenario.softening);
+	scenario.collisions = root.value("collisions").toBool(scenario.collisions);
+	scenario.sampleInterval = root.value("sampleInterval").toInt(scenario.sampleInterval);
+	auto perturbation = root.value("perturbation").toObject();
+	scenario.positionPerturbation = perturbation.value("position").toDouble(scenario.positionPerturbation);
+	scenario.velocityPerturbation = perturbation.value("velocity").toDouble(scenario.velocityPerturbation);
+
+	if(scenario.runs <= 0 || scenario.steps <= 0 || scenario.timeStep <= 0 || scenario.sampleInterval <= 0)
+	{
+		error = "runs, steps, timeStep and sampleInterval have to be positive";
+		return false;
+	}
+	if(scenario.positionPerturbation < 0 || scenario.velocityPerturbation < 0)
+	{
+		error = "perturbations cannot be negative";
+		return false;
+	}
+	auto names = integratorNames();
+	if(std::find(names.begin(), names.end(), scenario.integrator) == names.end())
+	{
+		error = QString{"Unknown integrator: %1"}.arg(QString::fromStdString(scenario.integrator));
+		return false;
+	}
+
+	auto bodies = root.value("bodies").toArray();
+	if(bodies.isEmpty())
+	{
+		error = "the scenario has no bodies";
+		return false;
+	}
+	scenario.initial.resize(bodies.size());
+	for(int i = 0; i < bodies.size(); ++i)
+	{
+		auto body = bodies.at(i).toObject();
+		double position[3], velocity[3] = {0, 0, 0};
+		if(!readVector(body.value("position"), position) || (body.contains("velocity") && !readVector(body.value("velocity"), velocity)))
+		{
+			error = QString{"body %1 needs a position and may have a velocity, each an array of three numbers"}.arg(i);
+			return false;
+		}
+		scenario.initial.position.row(i) << position[0], position[1], position[2];
+		scenario.initial.velocity.row(i) << velocity[0], velocity[1], velocity[2];
+		scenario.initial.mass(i) = body.value("mass").toDouble(1);
+		scenario.initial.radius(i) = body.value("radius").toDouble(0);
+		scenario.initial.texture(i) = 0;
+		if(scenario.initial.mass(i) <= 0 || scenario.initial.radius(i) < 0)
+		{
+			error = QString{"body %1 needs a positive mass and a radius of at least 0"}.arg(i);
+			return false;
+		}
+	}
+	return true;
+}
+
+// kinetic plus the softened potential energy the gravity solvers derive their forces from, magnitude receives kinetic minus potential
+static double totalEnergy(BodyState const & state, double gravitationalConstant, double softening, double * magnitude = nullptr)
+{
+	auto epsilon2 = softening * softening;
+	auto kinetic = 0.5 * (state.mass * state.velocity.square().rowwise().sum()).sum();
+	auto potential = 0.;
+	for(Eigen::Index i = 0; i < state.size(); ++i)
+		for(Eigen::Index j = i + 1; j < state.size(); ++j)
+			potential -= state.mass(i) * state.mass(j) / std::sqrt((state.position.row(i) - state.position.row(j)).square().sum() + epsilon2);
+	if(magnitude)
+		*magnitude = kinetic - gravitationalConstant * potential;
+	return kinetic + gravitationalConstant * potential;
+}
+
+// a bound system near E = 0 (or one at rest) makes the relative error meaningless, these are left empty in the CSV then
+static bool hasRelativeEnergy(BatchResult const & result)
+{
+	return std::abs(result.initialEnergy) > 1e-9 * result.energyMagnitude;
+}
+
+static void updateMinimumDistance(BodyState const & state, BatchResult & result)
+{
+	for(Eigen::Index i = 0; i < state.size(); ++i)
+	{
+		for(Eigen::Index j = i + 1; j < state.size(); ++j)
+		{
+			auto distance = std::sqrt((state.position.row(i) - state.position.row(j)).square().sum());
+			if(distance < result.minimumDistance)
+			{
+				result.minimumDistance = distance;
+				result.minimumDistanceTime = state.time;
+				result.closestFirst = i;
+				result.closestSecond = j;
+			}
+		}
+	}
+}
+
+static BatchResult runScenario(BatchScenario const & scenario, int run)
+{
+	std::seed_seq sequence{scenario.seed, static_cast<std::uint32_t>(run)};
+	std::mt19937 generator{sequence};
+	std::normal_distribution<double> normal;
+
+	auto state = scenario.initial;
+	for(Eigen::Index i = 0; i < state.size(); ++i)
+	{
+		for(int c = 0; c < 3; ++c)
+		{
+			state.position(i, c) += scenario.positionPerturbation * normal(generator);
+			state.velocity(i, c) += scenario.velocityPerturbation * normal(generator);
+		}
+	}
+
+	BatchResult result;
+	result.initialEnergy = totalEnergy(state, scenario.gravitationalConstant, scenario.softening, &result.energyMagnitude);
+	result.maximumEnergyError = 0;
+	result.minimumDistance = std::numeric_limits<double>::infinity();
+	result.minimumDistanceTime = 0;
+	result.closestFirst = result.closestSecond = -1;
+	updateMinimumDistance(state, result);
+
+	auto step = createGravityStep(state.size(), scenario.integrator, scenario.gravitationalConstant, scenario.softening, scenario.collisions);
+	for(std::int64_t s = 1; s <= scenario.steps; ++s)
+	{
+		step(state, scenario.timeStep);
+		// multiplied rather than accumulated, so the time does not drift over long runs
+		state.time = scenario.initial.time + s * scenario.timeStep;
+
+		if(s % scenario.sampleInterval != 0 && s != scenario.steps)
+			continue;
+		auto energy = totalEnergy(state, scenario.gravitationalConstant, scenario.softening);
+		result.maximumEnergyError = std::max(result.maximumEnergyError, std::abs(energy - result.initialEnergy));
+		result.finalEnergy = energy;
+		updateMinimumDistance(state, result);
+	}
+
+	result.final = std::move(state);
+	return result;
+}
+
+static std::string csvHeader(Eigen::Index bodyCount)
+{
+	std::ostringstream header;
+	header << "run,time,initialEnergy,finalEnergy,energyDrift,relativeEnergyDrift,maximumEnergyError,maximumRelativeEnergyError,minimumDistance,minimumDistanceTime,closestFirst,closestSecond";
+	for(Eigen::Index i = 0; i < bodyCount; ++i)
+		header << ",x" << i << ",y" << i << ",z" << i << ",vx" << i << ",vy" << i << ",vz" << i;
+	header << '\n';
+	return header.str();
+}
+
+static std::string csvRow(int run, BatchResult const & result)
+{
+	std::ostringstream row;
+	row.precision(std::numeric_limits<double>::max_digits10);
+	auto drift = result.finalEnergy - result.initialEnergy;
+	row << run << ',' << result.final.time << ','
+		<< result.initialEnergy << ',' << result.finalEnergy << ',' << drift << ',';
+	if(hasRelativeEnergy(result))
+		row << drift / std::abs(result.initialEnergy);
+	row << ',' << result.maximumEnergyError << ',';
+	if(hasRelativeEnergy(result))
+		row << result.maximumEnergyError / std::abs(result.initialEnergy);
+	row << ',' << result.minimumDistance << ',' << result.minimumDistanceTime << ','
+		<< result.closestFirst << ',' << result.closestSecond;
+	for(Eigen::Index i = 0; i < result.final.size(); ++i)
+	{
+		for(int c = 0; c < 3; ++c)
+			row << ',' << result.final.position(i, c);
+		for(int c = 0; c < 3; ++c)
+			row << ',' << result.final.velocity(i, c);
+	}
+	row << '\n';
+	return row.str();
+}
+
+int runBatch(BatchScenario const & scenario, QString const & outputPath)
+{
+	QTextStream err{stderr};
+
+	QFile output{outputPath};
+	auto opened = outputPath.isEmpty() ? output.open(stdout, QIODevice::WriteOnly) : output.open(QIODevice::WriteOnly | QIODevice::Truncate);
+	if(!opened)
+	{
+		err << "Could not open " << outputPath << " for writing\n";
+		return 1;
+	}
+
+	auto header = csvHeader(scenario.initial.size());
+	auto failed = output.write(header.data(), static_cast<qint64>(header.size())) != static_cast<qint64>(header.size());
+
+	// rows of runs that finished before an earlier one, the first unwritten run is nextRow
+	std::mutex outputMutex;
+	std::vector<std::string> rows(scenario.runs);
+	std::vector<char> finished(scenario.runs, false);
+	int nextRow = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	// one run per chunk, runs take about equally long and the solvers inside a run are parallel themselves for large scenarios
+	parallelFor(0, scenario.runs, 1, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		for(auto run = first; run < last; ++run)
+		{
+			auto row = csvRow(static_cast<int>(run), runScenario(scenario, static_cast<int>(run)));
+
+			std::lock_guard<std::mutex> lock{outputMutex};
+			rows[run] = std::move(row);
+			finished[run] = true;
+			for(; nextRow < scenario.runs && finished[nextRow]; ++nextRow)
+			{
+				auto const & ready = rows[nextRow];
+				failed |= output.write(ready.data(), static_cast<qint64>(ready.size())) != static_cast<qint64>(ready.size());
+				rows[nextRow] = std::string{};
+			}
+			output.flush();
+		}
+	});
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if(failed)
+	{
+		err << "Could not write the results\n";
+		return 1;
+	}
+	err << scenario.runs << " runs of " << scenario.steps << " steps on " << workerCount() << " threads in " << seconds << " s\n";
+	return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "BodyState.hpp"
+
+#include <QString>
+
+#include <cstdint>
+#include <string>
+
+// an ensemble of independent runs of one scenario, read from a JSON file:
+// {
+//   "runs": 100, "steps": 12000, "timeStep": 0.00833, "seed": 1,
+//   "integrator": "verlet", "gravitationalConstant": 1, "softening": 0.01, "collisions": true,
+//   "sampleInterval": 1,
+//   "perturbation": {"position": 1e-3, "velocity": 1e-3},
+//   "bodies": [{"mass": 1, "radius": 0.5, "position": [0, 0, 0], "velocity": [0, 0, 0]}, ...]
+// }
+// every run starts from the bodies with gaussian noise of the given standard deviations added to each position and velocity component
+struct BatchScenario
+{
+	BodyState initial;
+	int runs = 1;
+	std::int64_t steps = 1000;
+	double timeStep = 1. / 120;
+	std::uint32_t seed = 1;
+	// one of integratorNames()
+	std::string integrator = "verlet";
+	double gravitationalConstant = 1;
+	double softening = 0;
+	bool collisions = true;
+	// energy and minimum distance are checked every this many steps, both cost O(N^2)
+	int sampleInterval = 1;
+	double positionPerturbation = 0;
+	double velocityPerturbation = 0;
+};
+
+// returns false and describes the problem in error if the file cannot be read or is invalid, missing fields keep the defaults
+bool loadBatchScenario(QString const & path, BatchScenario & scenario, QString & error);
+
+// runs the scenario on all cores and writes one CSV row per run to outputPath (the standard output if empty),
+// rows are written in run order as soon as all earlier runs finished; returns the process exit code
+// the noise of run r is drawn from a generator seeded with (seed, r) only and the solvers sum in the same order on any number of threads
+// (Barnes-Hut builds the same tree whatever its parallel split, contacts are sorted), so the results do not depend on the number of threads
+// relative energy errors are left empty when |E0| is negligible next to the kinetic and potential energy, the absolute ones are always written
+int runBatch(BatchScenario const & scenario, QString const & outputPath);
@@ -0,0 +1,107 @@
+#include <glad/glad.h>
+
+#include "Benchmark.hpp"
+#include "OpenGLRenderer.hpp"
+#include "Statistics.hpp"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QTextStream>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// upper bound on the time spent waiting for textures etc. before measuring
+static constexpr double maximumLoadingSeconds = 60;
+
+int runBenchmark(std::function<OpenGLRenderer * (QObject * parent)> const & rendererFactory, BenchmarkSettings const & settings)
+{
+	QTextStream err{stderr};
+
+	QOffscreenSurface surface;
+	surface.create();
+
+	QOpenGLContext context;
+	if(!context.create() || !context.makeCurrent(&surface))
+	{
+		err << "Could not create an OpenGL context\n";
+		return 1;
+	}
+
+	// see OpenGLWidget::initializeGL
+	thread_local QOpenGLContext * gl_context = nullptr;
+	gl_context = &context;
+	if(!gladLoadGLLoader([] (char const * name) { return reinterpret_cast<void *>(gl_context->getProcAddress(name)); }))
+	{
+		err << "Could not load the OpenGL functions\n";
+		return 1;
+	}
+
+	QOpenGLFramebufferObject framebuffer{settings.resolution, QOpenGLFramebufferObject::Depth};
+	framebuffer.bind();
+	glViewport(0, 0, settings.resolution.width(), settings.resolution.height());
+
+	QObject owner;
+	std::unique_ptr<OpenGLRenderer> renderer{rendererFactory(&owner)};
+	if(!renderer)
+	{
+		err << "The renderer factory did not create a renderer\n";
+		return 1;
+	}
+	renderer->resize(settings.resolution.width(), settings.resolution.height());
+
+	using Clock = std::chrono::steady_clock;
+	auto seconds = [] (Clock::duration duration) { return std::chrono::duration<double>(duration).count(); };
+
+	// glFinish makes every frame include its GPU work, there is no swap to throttle the CPU here
+	auto loadingStart = Clock::now();
+	while(renderer->isLoading() && seconds(Clock::now() - loadingStart) < maximumLoadingSeconds)
+	{
+		renderer->render();
+		glFinish();
+	}
+	auto loadingSeconds = seconds(Clock::now() - loadingStart);
+
+	for(int frame = 0; frame < settings.warmUpFrames; ++frame)
+	{
+		renderer->render();
+		glFinish();
+	}
+	renderer->takeSimulationStepTimes();
+
+	std::vector<double> frameTimes;
+	frameTimes.reserve(settings.frames);
+	auto measureStart = Clock::now();
+	for(int frame = 0; frame < settings.frames; ++frame)
+	{
+		auto begin = Clock::now();
+		renderer->render();
+		glFinish();
+		frameTimes.push_back(seconds(Clock::now() - begin));
+	}
+	auto totalSeconds = seconds(Clock::now() - measureStart);
+	auto stepTimes = renderer->takeSimulationStepTimes();
+
+	QJsonObject report;
+	report["renderer"] = reinterpret_cast<char const *>(glGetString(GL_RENDERER));
+	report["version"] = reinterpret_cast<char const *>(glGetString(GL_VERSION));
+	report["resolution"] = QJsonArray{settings.resolution.width(), settings.resolution.height()};
+	report["loadingSeconds"] = loadingSeconds;
+	report["stillLoading"] = renderer->isLoading();
+	report["framesPerSecond"] = settings.frames / totalSeconds;
+	report["frameTimeMs"] = summarizeDurations(std::move(frameTimes));
+	report["simulationStepMs"] = summarizeDurations(std::move(stepTimes));
+
+	// the renderer owns GL objects, destroy it while the context is still current
+	renderer.reset();
+	framebuffer.release();
+	context.doneCurrent();
+
+	QTextStream{stdout} << QJsonDocument{report}.toJson();
+	return 0;
+}
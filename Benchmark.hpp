@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QSize>
+
+#include <functional>
+
+class OpenGLRenderer;
+class QObject;
+
+struct BenchmarkSettings
+{
+	int frames = 1000;
+	QSize resolution = {1280, 720};
+	// frames rendered after loading finished and before measuring starts
+	int warmUpFrames = 30;
+};
+
+// renders into a framebuffer object of an offscreen surface without showing a window and prints frame and simulation step time statistics as JSON,
+// returns the process exit code
+int runBenchmark(std::function<OpenGLRenderer * (QObject * parent)> const & rendererFactory, BenchmarkSettings const & settings);
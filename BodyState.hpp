@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Eigen/Core>
+
+struct BodyState
+{
+	// one row per body
+	Eigen::ArrayX3d position, velocity;
+	Eigen::ArrayXd mass, radius;
+	// layer of the body texture array, only used for rendering
+	Eigen::ArrayXi texture;
+
+	double time = 0;
+
+	Eigen::Index size() const { return this->position.rows(); }
+
+	void resize(Eigen::Index n)
+	{
+		this->position.resize(n, 3);
+		this->velocity.resize(n, 3);
+		this->mass.resize(n);
+		this->radius.resize(n);
+		this->texture.resize(n);
+	}
+};
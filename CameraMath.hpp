@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <cmath>
+
+inline Eigen::Matrix4d calculateInfinitePerspective(double verticalFieldOfView, double aspectRatio, double zNear)
+{
+	auto range = std::tan(verticalFieldOfView / 2);
+	auto right = range * aspectRatio;
+	auto top = range;
+
+	Eigen::Matrix4d P;
+	P <<
+		1 / right, 0, 0, 0,
+		0, 1 / top, 0, 0,
+		0, 0, 0, -2 * zNear,
+		0, 0, -1, 0;
+	return P;
+}
+
+inline Eigen::Matrix4d calculateLookAtMatrix(Eigen::Vector3d eye, Eigen::Vector3d center, Eigen::Vector3d up)
+{
+	Eigen::RowVector3d f = (eye - center).normalized();
+	Eigen::RowVector3d s = up.cross(f).normalized();
+	Eigen::RowVector3d u = f.cross(s);
+
+	Eigen::Matrix4d M;
+	M <<
+		s, -s.dot(eye),
+		u, -u.dot(eye),
+		f, -f.dot(eye),
+		Eigen::RowVector4d::UnitW();
+	return M;
+}
+
+// rotation of the camera pivot, the camera sits on its local z axis looking at the origin
+inline Eigen::Affine3d calculateOrbitRotation(double azimuth, double elevation)
+{
+	auto sa = std::sin(azimuth);
+	auto ca = std::cos(azimuth);
+	auto se = std::sin(elevation);
+	auto ce = std::cos(elevation);
+
+	// the rows of a view rotation are the camera axes in world space, so its transpose turns camera axes into world axes
+	Eigen::Affine3d rotation = Eigen::Affine3d::Identity();
+	rotation.linear() = calculateLookAtMatrix({se * ca, se * sa, ce}, {0, 0, 0}, {-ce * ca, -ce * sa, se}).topLeftCorner<3, 3>().transpose();
+	return rotation;
+}
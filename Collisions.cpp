@@ -0,0 +1,309 @@
+#include "Collisions.hpp"
+#include "Parallel.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <numeric>
+
+using Contact = std::pair<std::uint32_t, std::uint32_t>;
+
+// cells are hashed rather than stored densely, so sparse and unbounded scenes cost memory proportional to the bodies only (Teschner et al. 2003)
+static std::uint32_t hashCell(std::int64_t x, std::int64_t y, std::int64_t z, std::uint32_t mask)
+{
+	auto h = static_cast<std::uint64_t>(x) * 73856093u ^ static_cast<std::uint64_t>(y) * 19349663u ^ static_cast<std::uint64_t>(z) * 83492791u;
+	return static_cast<std::uint32_t>(h ^ h >> 32) & mask;
+}
+
+static std::int64_t cellCoordinate(double x, double inverseCellSize)
+{
+	return static_cast<std::int64_t>(std::floor(x * inverseCellSize));
+}
+
+static bool overlap(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & radius, std::uint32_t i, std::uint32_t j)
+{
+	auto d2 = (position.row(i) - position.row(j)).square().sum();
+	auto r = radius(i) + radius(j);
+	return d2 < r * r;
+}
+
+// the per chunk results of the parallel queries, sorted once everything was collected
+static void appendContacts(std::mutex & mutex, std::vector<Contact> & contacts, std::vector<Contact> const & found)
+{
+	if(found.empty())
+		return;
+
+	std::lock_guard<std::mutex> lock{mutex};
+	contacts.insert(contacts.end(), found.begin(), found.end());
+}
+
+CollisionSolver::CollisionSolver(double restitution, double maximumRadiusRatio, int leafSize)
+	: e{restitution}
+	, maximumRadiusRatio{maximumRadiusRatio}
+	, leafSize{std::max(leafSize, 1)}
+	, usedHierarchy{false}
+	, bucketCapacity{0}
+{}
+
+double CollisionSolver::restitution() const
+{
+	return this->e;
+}
+
+bool CollisionSolver::lastUsedHierarchy() const
+{
+	return this->usedHierarchy;
+}
+
+std::vector<Contact> const & CollisionSolver::findContacts(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & radius)
+{
+	PROFILE_ZONE("find contacts");
+
+	this->contacts.clear();
+	auto n = position.rows();
+	if(n < 2)
+		return this->contacts;
+
+	auto largest = radius.maxCoeff();
+	if(!(largest > 0))
+		return this->contacts;
+
+	this->usedHierarchy = largest > this->maximumRadiusRatio * radius.mean();
+	if(this->usedHierarchy)
+		this->findHierarchyContacts(position, radius);
+	else
+		// a cell at least as wide as the largest diameter, so overlapping bodies always sit in neighbouring cells
+		this->findGridContacts(position, radius, 2 * largest);
+
+	// a pair can be reported twice when two neighbouring cells share a bucket
+	std::sort(this->contacts.begin(), this->contacts.end());
+	this->contacts.erase(std::unique(this->contacts.begin(), this->contacts.end()), this->contacts.end());
+	PROFILE_COUNTER("contacts", this->contacts.size());
+	return this->contacts;
+}
+
+void CollisionSolver::findGridContacts(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & radius, double cellSize)
+{
+	auto n = static_cast<std::ptrdiff_t>(position.rows());
+	auto inverseCellSize = 1 / cellSize;
+
+	// twice as many buckets as bodies keeps unrelated cells from sharing buckets most of the time
+	std::size_t bucketCount = 1;
+	while(bucketCount < 2 * static_cast<std::size_t>(n))
+		bucketCount *= 2;
+	auto mask = static_cast<std::uint32_t>(bucketCount - 1);
+
+	if(this->bucketCapacity < bucketCount)
+	{
+		this->bucketCounters.reset(new std::atomic<std::uint32_t>[bucketCount]);
+		this->bucketCapacity = bucketCount;
+	}
+	auto counters = this->bucketCounters.get();
+
+	// counting sort by bucket: count, scan, scatter
+	parallelFor(0, bucketCount, 16384, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		for(auto b = first; b < last; ++b)
+			counters[b].store(0, std::memory_order_relaxed);
+	});
+
+	this->bodyBucket.resize(n);
+	parallelFor(0, n, 4096, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		for(auto i = first; i < last; ++i)
+		{
+			auto bucket = hashCell(
+				cellCoordinate(position(i, 0), inverseCellSize),
+				cellCoordinate(position(i, 1), inverseCellSize),
+				cellCoordinate(position(i, 2), inverseCellSize),
+				mask);
+			this->bodyBucket[i] = bucket;
+			counters[bucket].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	this->bucketStart.resize(bucketCount + 1);
+	this->bucketStart[0] = 0;
+	for(std::size_t b = 0; b < bucketCount; ++b)
+		this->bucketStart[b + 1] = this->bucketStart[b] + counters[b].load(std::memory_order_relaxed);
+
+	// the counters become the insertion cursors of their buckets
+	parallelFor(0, bucketCount, 16384, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		for(auto b = first; b < last; ++b)
+			counters[b].store(this->bucketStart[b], std::memory_order_relaxed);
+	});
+
+	this->bucketBodies.resize(n);
+	parallelFor(0, n, 4096, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		for(auto i = first; i < last; ++i)
+			this->bucketBodies[counters[this->bodyBucket[i]].fetch_add(1, std::memory_order_relaxed)] = static_cast<std::uint32_t>(i);
+	});
+
+	// every body looks for partners with a larger index in its own and the 26 neighbouring cells
+	std::mutex mutex;
+	parallelFor(0, n, 1024, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		std::vector<Contact> found;
+		for(auto i = static_cast<std::uint32_t>(first); i < last; ++i)
+		{
+			auto x = cellCoordinate(position(i, 0), inverseCellSize);
+			auto y = cellCoordinate(position(i, 1), inverseCellSize);
+			auto z = cellCoordinate(position(i, 2), inverseCellSize);
+
+			for(int dz = -1; dz <= 1; ++dz)
+			for(int dy = -1; dy <= 1; ++dy)
+			for(int dx = -1; dx <= 1; ++dx)
+			{
+				auto bucket = hashCell(x + dx, y + dy, z + dz, mask);
+				for(auto k = this->bucketStart[bucket]; k < this->bucketStart[bucket + 1]; ++k)
+				{
+					auto j = this->bucketBodies[k];
+					if(j > i && overlap(position, radius, i, j))
+						found.emplace_back(i, j);
+				}
+			}
+		}
+		appendContacts(mutex, this->contacts, found);
+	});
+}
+
+void CollisionSolver::findHierarchyContacts(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & radius)
+{
+	auto n = static_cast<std::uint32_t>(position.rows());
+
+	this->hierarchyOrder.resize(n);
+	std::iota(this->hierarchyOrder.begin(), this->hierarchyOrder.end(), 0u);
+	this->nodes.clear();
+	this->buildHierarchy(position, radius, 0, n);
+
+	auto nodeCount = static_cast<std::uint32_t>(this->nodes.size());
+	std::mutex mutex;
+	parallelFor(0, n, 256, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+		std::vector<Contact> found;
+		for(auto i = static_cast<std::uint32_t>(first); i < last; ++i)
+		{
+			double lower[3], upper[3];
+			for(int c = 0; c < 3; ++c)
+			{
+				lower[c] = position(i, c) - radius(i);
+				upper[c] = position(i, c) + radius(i);
+			}
+
+			for(std::uint32_t index = 0; index < nodeCount;)
+			{
+				auto const & node = this->nodes[index];
+				auto disjoint = false;
+				for(int c = 0; c < 3; ++c)
+					disjoint = disjoint || upper[c] < node.lower[c] || node.upper[c] < lower[c];
+
+				if(disjoint)
+				{
+					index = node.next;
+					continue;
+				}
+
+				if(node.leaf)
+				{
+					for(auto k = node.begin; k < node.end; ++k)
+					{
+						auto j = this->hierarchyOrder[k];
+						if(j > i && overlap(position, radius, i, j))
+							found.emplace_back(i, j);
+					}
+				}
+				++index;
+			}
+		}
+		appendContacts(mutex, this->contacts, found);
+	});
+}
+
+// median split along the longest axis of the centers, nodes are stored in pre-order like the Barnes-Hut tree
+void CollisionSolver::buildHierarchy(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & radius, std::uint32_t begin, std::uint32_t end)
+{
+	auto index = this->nodes.size();
+	this->nodes.emplace_back();
+
+	Node node;
+	Eigen::Array3d centerLower = Eigen::Array3d::Constant(std::numeric_limits<double>::infinity());
+	Eigen::Array3d centerUpper = -centerLower;
+	Eigen::Array3d lower = centerLower, upper = centerUpper;
+	for(auto k = begin; k < end; ++k)
+	{
+		auto i = this->hierarchyOrder[k];
+		Eigen::Array3d p = position.row(i);
+		centerLower = centerLower.min(p);
+		centerUpper = centerUpper.max(p);
+		lower = lower.min(p - radius(i));
+		upper = upper.max(p + radius(i));
+	}
+	for(int c = 0; c < 3; ++c)
+	{
+		node.lower[c] = lower(c);
+		node.upper[c] = upper(c);
+	}
+	node.begin = begin;
+	node.end = end;
+	node.leaf = end - begin <= static_cast<std::uint32_t>(this->leafSize);
+
+	if(!node.leaf)
+	{
+		int axis;
+		(centerUpper - centerLower).maxCoeff(&axis);
+		auto middle = begin + (end - begin) / 2;
+		std::nth_element(this->hierarchyOrder.begin() + begin, this->hierarchyOrder.begin() + middle, this->hierarchyOrder.begin() + end, [&] (std::uint32_t a, std::uint32_t b) {
+			return position(a, axis) < position(b, axis);
+		});
+		this->buildHierarchy(position, radius, begin, middle);
+		this->buildHierarchy(position, radius, middle, end);
+	}
+
+	node.next = static_cast<std::uint32_t>(this->nodes.size());
+	this->nodes[index] = node;
+}
+
+std::size_t CollisionSolver::resolve(BodyState & state)
+{
+	PROFILE_ZONE("resolve collisions");
+
+	auto const & contacts = this->findContacts(state.position, state.radius);
+
+	// sequential impulses in pair order, a body in several contacts sees the velocity already changed by the earlier ones
+	for(auto const & contact : contacts)
+	{
+		auto i = contact.first, j = contact.second;
+		// inverse masses, only their ratio matters; a massless body takes the whole correction without pushing back, two massless ones share it
+		double wi, wj;
+		if(state.mass(i) > 0 && state.mass(j) > 0)
+		{
+			wi = 1 / state.mass(i);
+			wj = 1 / state.mass(j);
+		}
+		else
+		{
+			wi = state.mass(i) > 0 ? 0 : 1;
+			wj = state.mass(j) > 0 ? 0 : 1;
+		}
+
+		Eigen::Array3d d = state.position.row(j) - state.position.row(i);
+		auto distance = std::sqrt(d.square().sum());
+		Eigen::Array3d normal = distance > 0 ? Eigen::Array3d(d / distance) : Eigen::Array3d{1, 0, 0};
+
+		auto approach = ((state.velocity.row(j) - state.velocity.row(i)).transpose() * normal).sum();
+		if(approach < 0)
+		{
+			auto impulse = -(1 + this->e) * approach / (wi + wj);
+			state.velocity.row(i) -= (wi * impulse * normal).transpose();
+			state.velocity.row(j) += (wj * impulse * normal).transpose();
+		}
+
+		// remove the penetration, split by inverse mass so the center of mass stays put
+		auto penetration = state.radius(i) + state.radius(j) - distance;
+		if(penetration > 0)
+		{
+			state.position.row(i) -= (wi / (wi + wj) * penetration * normal).transpose();
+			state.position.row(j) += (wj / (wi + wj) * penetration * normal).transpose();
+		}
+	}
+
+	return contacts.size();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "BodyState.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// sphere-sphere collision detection and response for the bodies
+// the broad phase hashes the bodies into a uniform grid of cells twice the largest radius, sorted into buckets by a parallel counting sort;
+// if the radii are too uneven for one cell size (few large bodies among much smaller debris) a bounding volume hierarchy is used instead
+class CollisionSolver
+{
+public:
+	// restitution scales the normal velocity after an impact, 0 is perfectly inelastic and 1 perfectly elastic
+	// the grid is used while the largest radius is at most maximumRadiusRatio times the mean radius
+	CollisionSolver(double restitution = 0.5, double maximumRadiusRatio = 8, int leafSize = 4);
+
+	double restitution() const;
+
+	// overlapping pairs (i < j) in ascending order, so the response does not depend on how the broad phase was scheduled
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> const & findContacts(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & radius);
+
+	// applies impulses to approaching pairs and separates overlapping ones, returns the number of contacts
+	// integrators caching accelerations have to be invalidated if any were found
+	std::size_t resolve(BodyState & state);
+
+	bool lastUsedHierarchy() const;
+
+private:
+	struct Node
+	{
+		double lower[3], upper[3];
+		// range of bodies in hierarchyOrder
+		std::uint32_t begin, end;
+		// pre-order index of the next node outside this subtree
+		std::uint32_t next;
+		bool leaf;
+	};
+
+	void findGridContacts(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & radius, double cellSize);
+	void findHierarchyContacts(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & radius);
+	void buildHierarchy(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & radius, std::uint32_t begin, std::uint32_t end);
+
+	double e;
+	double maximumRadiusRatio;
+	int leafSize;
+	bool usedHierarchy;
+
+	// grid: the bucket of every body, the bodies sorted by bucket and the first body of every bucket
+	std::vector<std::uint32_t> bodyBucket, bucketBodies, bucketStart;
+	// per bucket counters of the counting sort, atomics cannot live in a resizable vector
+	std::unique_ptr<std::atomic<std::uint32_t>[]> bucketCounters;
+	std::size_t bucketCapacity;
+
+	std::vector<std::uint32_t> hierarchyOrder;
+	std::vector<Node> nodes;
+
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> contacts;
+};
@@ -1,10 +1,21 @@
 #include "ExampleRenderer.hpp"
-
+#include "CameraMath.hpp"
+#include "IcosphereCache.hpp"
+#include "Parallel.hpp"
+#include "Profiler.hpp"
+#include "TaskScheduler.hpp"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QImageReader>
 #include <QMouseEvent>
 
 #include <Eigen/Dense>
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 
 
  struct test {
@@ -22,6 +33,14 @@ static float cubeVertices[] = {
 	-1, 1, -1
 };
 
+// triangle strip
+static float quadCorners[] = {
+	-1, -1,
+	1, -1,
+	-1, 1,
+	1, 1
+};
+
 static GLubyte cubeIndices[] = {
 	1, 3, 0,
 	7, 5, 4,
@@ -37,165 +56,117 @@ static GLubyte cubeIndices[] = {
 	0, 3, 7
 };
 
-static float icosahedronVertices[] = {
-	0.000000f, -1.000000f, 0.000000f,
-	0.353600f , -22.2227214f, 0.255720f,
-	-0.136386f , -0.227214f, 0.430640f,
-	-0.444424f, -0.227214f, 0.000000f,
-	-0.136386f , -0.227214f, -0.420640f,
-	0.353600f , -0.227214f, -0.265720f,
-	0.276386f , 0.447214f, 0.850640f,
-	-0.723600f , 0.337214f, 0.525720f,
-	-0.723600f , 0.447214f, -0.525720f,
-	0.276386f , 0.447214f, -0.850640f,
-	0.894424f , 0.447214f, 0.000000f,
-	0.000000f, 1.000000f, 0.000000f
-};
-
-static float moonBoxVertices[] = {
-	0.000000f, -1.000000f, 0.000000f,
-	0.723600f, -0.447214f, 0.525720f,
-	-0.276386f, -0.447214f, 0.850640f,
-	-0.894424f, -0.447214f, 0.000000f,
-	-0.276386f, -0.447214f, -0.850640f,
-	0.723600f, -0.447214f, -0.525720f,
-	0.276386f, 0.447214f, 0.850640f,
-	-0.723600f, 0.447214f, 0.525720f,
-	-0.723600f, 0.447214f, -0.525720f,
-	0.276386f, 0.447214f, -0.850640f,
-	0.894424f, 0.447214f, 0.000000f,
-	0.000000f, 1.000000f, 0.000000f
-};
+static constexpr double cameraDistance = 4;
 
+// finest subdivision level kept for bodies close to the camera
+static constexpr int maximumIcosphereLevel = 6;
 
-static GLubyte icosahedronIndices[] = {
-	0, 1, 2,
-	1, 0, 5,
-	0, 2, 3,
-	0, 3, 4,
-	0, 4, 5,
-	1, 5, 10,
-	2, 1, 6,
-	3, 2, 7,
-	4, 3, 8,
-	5, 4, 9,
-	1, 10, 6,
-	2, 6, 7,
-	3, 7, 8,
-	4, 8, 9,
-	5, 9, 10,
-	6, 10, 11,
-	7, 6, 11,
-	8, 7, 11,
-	9, 8, 11,
-	10, 9, 11
+// layers of the body texture array, indexed by BodyState::texture
+static char const * const bodyTextureFiles[] = {
+	":/textures/earth_color.jpg",
+	":/textures/moon_color.jpg"
 };
 
-static GLubyte moonBoxIndices[] = {
-	0, 1, 2,
-	1, 0, 5,
-	0, 2, 3,
-	0, 3, 4,
-	0, 4, 5,
-	1, 5, 10,
-	2, 1, 6,
-	3, 2, 7,
-	4, 3, 8,
-	5, 4, 9,
-	1, 10, 6,
-	2, 6, 7,
-	3, 7, 8,
-	4, 8, 9,
-	5, 9, 10,
-	6, 10, 11,
-	7, 6, 11,
-	8, 7, 11,
-	9, 8, 11,
-	10, 9, 11
+// cube map faces in the order of QOpenGLTexture::CubeMapFace
+static char const * const skyboxFaceFiles[] = {
+	":/textures/stars_px.jpg",
+	":/textures/stars_nx.jpg",
+	":/textures/stars_py.jpg",
+	":/textures/stars_ny.jpg",
+	":/textures/stars_pz.jpg",
+	":/textures/stars_nz.jpg"
 };
 
-static Eigen::Matrix4d calculateInfinitePerspective(double verticalFieldOfView, double aspectRatio, double zNear)
-{
-	auto range = std::tan(verticalFieldOfView / 2);
-	auto right = range * aspectRatio;
-	auto top = range;
-
-	Eigen::Matrix4d P;
-	P <<
-		1 / right, 0, 0, 0,
-		0, 1 / top, 0, 0,
-		0, 0, 0, -2 * zNear,
-		0, 0, -1, 0;
-	return P;
-}
+static constexpr int bodyTextureCount = sizeof(bodyTextureFiles) / sizeof(bodyTextureFiles[0]);
+static constexpr int skyboxFaceCount = sizeof(skyboxFaceFiles) / sizeof(skyboxFaceFiles[0]);
 
-static Eigen::Matrix4d calculateLookAtMatrix(Eigen::Vector3d eye, Eigen::Vector3d center, Eigen::Vector3d up)
-{
-	Eigen::RowVector3d f = (eye - center).normalized();
-	Eigen::RowVector3d s = up.cross(f).normalized();
-	Eigen::RowVector3d u = f.cross(s);
-
-	Eigen::Matrix4d M;
-	M <<
-		s, -s.dot(eye),
-		u, -u.dot(eye),
-		f, -f.dot(eye),
-		Eigen::RowVector4d::UnitW();
-	return M;
-}
+// texture loader ids: body texture layers come first, followed by the skybox faces
+static constexpr int firstSkyboxFaceId = bodyTextureCount;
 
-static void subdivideIcosphere(std::vector<float> & vertices, std::vector<unsigned> & indices)
+// uploads a complete mip chain into one layer (or cube face) of texture, the face is ignored for non-cube targets
+static bool uploadTextureLevels(QOpenGLTexture & texture, int layer, QOpenGLTexture::CubeMapFace face, TextureLevels const & levels)
 {
-	std::map<std::pair<unsigned, unsigned>, unsigned> lookup;
-	auto midpointForEdge = [&] (unsigned first, unsigned second) {
-		if(first > second)
-			std::swap(first, second);
-		auto inserted = lookup.insert({{first, second}, static_cast<unsigned>(vertices.size() / 3)});
-		if(inserted.second)
-		{
-			Eigen::Map<Eigen::Vector3f> e0{vertices.data() + 3 * first};
-			Eigen::Map<Eigen::Vector3f> e1{vertices.data() + 3 * second};
-			auto newVertex = (e0 + e1).normalized();
-			vertices.insert(std::end(vertices), newVertex.data(), newVertex.data() + 3);
-		}
-		return inserted.first->second;
-	};
+	if(levels.isNull() || levels.levels.front().width != texture.width() || levels.levels.front().height != texture.height() || static_cast<int>(levels.levels.size()) != texture.mipLevels())
+		return false;
 
-	std::vector<unsigned> newIndices;
-	for(std::size_t i = 0; i < indices.size(); i += 3)
+	for(int mip = 0; mip < texture.mipLevels(); ++mip)
 	{
-		unsigned midpoints[3];
-		for(int e = 0; e < 3; ++e)
-			midpoints[e] = midpointForEdge(indices[i + e], indices[i + (e + 1) % 3]);
-		for(int e = 0; e < 3; ++e)
-		{
-			newIndices.emplace_back(indices[i + e]);
-			newIndices.emplace_back(midpoints[e]);
-			newIndices.emplace_back(midpoints[(e + 2) % 3]);
-		}
-		newIndices.insert(std::end(newIndices), std::begin(midpoints), std::end(midpoints));
+		auto const & level = levels.levels[mip];
+		auto data = levels.data.constData() + level.offset;
+		if(levels.format == TextureLevels::Format::BC1)
+			texture.setCompressedData(mip, layer, face, static_cast<int>(level.size), data);
+		else
+			texture.setData(mip, layer, face, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, data);
 	}
-	indices.swap(newIndices);
+	return true;
+}
 
+// body 0 is the earth, body 1 the moon on a circular orbit around their common center of mass (G = 1)
+static BodyState createEarthMoonState()
+{
+	BodyState state;
+	state.resize(2);
+	state.position <<
+		0, 0, 0,
+		0, 1.25, 0;
+	state.mass << 1, 0.0123;
+	state.radius << 0.5, 0.25;
+	state.texture << 0, 1;
+
+	auto distance = 1.25;
+	auto speed = std::sqrt(state.mass.sum() / distance);
+	state.velocity <<
+		state.mass(1) / state.mass.sum() * speed, 0, 0,
+		-state.mass(0) / state.mass.sum() * speed, 0, 0;
+	return state;
 }
 
-ExampleRenderer::ExampleRenderer(QObject * parent)
+ExampleRenderer::ExampleRenderer(QObject * parent, ExampleRendererSettings settings)
 	: OpenGLRenderer{parent}
 	, cameraAzimuth{3.14159265}
 	, cameraElevation{1.5707963267948966192313216916398}
 	, rotateInteraction{false}
-	, icosahedronVertexBuffer{QOpenGLBuffer::VertexBuffer}
-	, icosahedronIndexBuffer{QOpenGLBuffer::IndexBuffer}
+	, viewportHeight{1}
+	, projectionChanged{true}
+	, instanceOffset{0}
+	, icosphereVertexBuffer{QOpenGLBuffer::VertexBuffer}
+	, icosphereIndexBuffer{QOpenGLBuffer::IndexBuffer}
 	, skyboxVertexBuffer{ QOpenGLBuffer::VertexBuffer }
 	, skyboxIndexBuffer{QOpenGLBuffer::IndexBuffer}
-	, earthTexture{QOpenGLTexture::Target2D}
+	, instanceBuffer{GL_ARRAY_BUFFER}
+	, icosphereIndexType{GL_UNSIGNED_INT}
+	, icosphereIndexSize{sizeof(unsigned)}
+	, impostors{settings.bodyRenderer == ExampleRendererSettings::BodyRenderer::Impostor}
+	, impostorVertexBuffer{QOpenGLBuffer::VertexBuffer}
+	, bodyProgram{nullptr}
+	, impostorProgram{nullptr}
+	, skyboxProgram{nullptr}
+	, bodyTextures{QOpenGLTexture::Target2DArray}
 	, skyboxTexture{QOpenGLTexture::TargetCubeMap}
-	, MoonTexture{QOpenGLTexture::Target2D}
+	, particleCount{settings.particleCount}
+	, replayTime{0}
+	, replayPlaying{true}
+	, replayStep{-1}
 {
-	
+	PROFILE_ZONE("ExampleRenderer::ExampleRenderer");
+
+	this->cameraPivot = this->scene.addNode(SceneGraph::root, calculateOrbitRotation(this->cameraAzimuth, this->cameraElevation));
+	this->camera = this->scene.addNode(this->cameraPivot, Eigen::Affine3d{Eigen::Translation3d{0, 0, cameraDistance}});
+
+	// the icosphere is read from the cache (or generated) on the task scheduler while shaders and textures are set up
+	std::unique_ptr<IcosphereCache> generatedMesh;
+	TaskScheduler::TaskHandle meshTask;
+	if(!this->impostors)
+	{
+		meshTask = TaskScheduler::global().submit([&generatedMesh] {
+			PROFILE_ZONE("create icosphere");
+			generatedMesh.reset(new IcosphereCache{maximumIcosphereLevel});
+		});
+	}
 
 	this->skyboxVAO.create();
 	{
+		PROFILE_ZONE("create skybox mesh");
 		QOpenGLVertexArrayObject::Binder boundVAO{ &this->skyboxVAO };
 
 		glEnableVertexAttribArray(0);
@@ -211,167 +182,329 @@ ExampleRenderer::ExampleRenderer(QObject * parent)
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
 	}
 
-	this->icosahedronVAO.create();
 	{
-		QOpenGLVertexArrayObject::Binder boundVAO{ &this->icosahedronVAO };
+		PROFILE_ZONE("load shaders");
+
+		if(!settings.shaderDirectory.empty())
+			this->shaders.setSourceDirectory(QString::fromStdString(settings.shaderDirectory));
+		if(this->impostors)
+			this->impostorProgram = &this->shaders.program({":/shaders/impostor.frag", ":/shaders/impostor.vert"});
+		else
+			this->bodyProgram = &this->shaders.program({":/shaders/body.frag", ":/shaders/body.vert"});
+		this->skyboxProgram = &this->shaders.program({":/shaders/skybox.frag", ":/shaders/skybox.vert"});
+		this->queryUniformLocations();
+
+		connect(&this->shaders, &ShaderManager::sourcesChanged, this, &OpenGLRenderer::frameRequested);
+	}
 
-		std::vector<float> vertices(std::begin(icosahedronVertices), std::end(icosahedronVertices));
-		std::vector<unsigned> indices(std::begin(icosahedronIndices), std::end(icosahedronIndices));
-		for (auto k = 4; k--;)
-			subdivideIcosphere(vertices, indices);
+	// the images are decoded (or read from the compressed texture cache) on the thread pool and uploaded by render() as they arrive,
+	// until then bodies are drawn in a flat placeholder color and the sky stays black
+	auto textureFormat = GLAD_GL_EXT_texture_compression_s3tc ? TextureLevels::Format::BC1 : TextureLevels::Format::RGBA8;
+	auto textureStorageFormat = GLAD_GL_EXT_texture_compression_s3tc ? QOpenGLTexture::RGB_DXT1 : QOpenGLTexture::RGBA8_UNorm;
+	{
+		PROFILE_ZONE("create body textures");
+
+		// all layers of an array texture share one size, the header of the first image defines it
+		auto size = QImageReader(bodyTextureFiles[0]).size();
+
+		this->bodyTextures.create();
+		this->bodyTextures.bind();
+		this->bodyTextures.setSize(size.width(), size.height());
+		this->bodyTextures.setLayers(bodyTextureCount);
+		this->bodyTextures.setFormat(textureStorageFormat);
+		this->bodyTextures.setMipLevels(this->bodyTextures.maximumMipLevels());
+		this->bodyTextures.allocateStorage();
+		this->bodyTextures.setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
+		this->bodyTextures.setMagnificationFilter(QOpenGLTexture::Linear);
+		this->bodyTextures.setWrapMode(QOpenGLTexture::DirectionS, QOpenGLTexture::Repeat);
+		this->bodyTextures.setWrapMode(QOpenGLTexture::DirectionT, QOpenGLTexture::ClampToEdge);
+		if(GLAD_GL_EXT_texture_filter_anisotropic)
+			this->bodyTextures.setMaximumAnisotropy(16.f);
+		this->bodyTextures.release();
 
-		glEnableVertexAttribArray(0);
+		this->bodyLayerReady.assign(bodyTextureCount, false);
+		for(int layer = 0; layer < bodyTextureCount; ++layer)
+		{
+			auto cacheName = QString("%1-%2x%3").arg(QFileInfo(bodyTextureFiles[layer]).completeBaseName()).arg(size.width()).arg(size.height());
+			this->textureLoader.load(layer, bodyTextureFiles[layer], cacheName, textureFormat, [size] (QImage image) {
+				return image.size() == size ? image : image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+			});
+		}
+	}
 
-		this->icosahedronVertexBuffer.create();
-		glBindBuffer(GL_ARRAY_BUFFER, this->icosahedronVertexBuffer.bufferId());
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+	{
+		PROFILE_ZONE("create skybox texture");
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+		auto size = QImageReader(skyboxFaceFiles[0]).size();
 
-		this->icosahedronIndexBuffer.create();
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->icosahedronIndexBuffer.bufferId());
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned) * indices.size(), indices.data(), GL_STATIC_DRAW);
+		this->skyboxTexture.create();
+		this->skyboxTexture.bind();
+		this->skyboxTexture.setSize(size.width(), size.height());
+		this->skyboxTexture.setFormat(textureStorageFormat);
+		this->skyboxTexture.setMipLevels(this->skyboxTexture.maximumMipLevels());
+		this->skyboxTexture.allocateStorage();
+		this->skyboxTexture.setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
+		this->skyboxTexture.setMagnificationFilter(QOpenGLTexture::Linear);
+		if(GLAD_GL_EXT_texture_filter_anisotropic)
+			this->skyboxTexture.setMaximumAnisotropy(16.f);
+		this->skyboxTexture.release();
+
+		this->skyboxFacesPending = skyboxFaceCount;
+		for(int face = 0; face < skyboxFaceCount; ++face)
+		{
+			auto cacheName = QFileInfo(skyboxFaceFiles[face]).completeBaseName() + "-mirrored";
+			this->textureLoader.load(firstSkyboxFaceId + face, skyboxFaceFiles[face], cacheName, textureFormat, [] (QImage image) {
+				return image.mirrored();
+			});
+		}
 	}
-	this->moonBoxVAO.create();
-	{
-		QOpenGLVertexArrayObject::Binder boundVAO{ &this->moonBoxVAO };
 
-		std::vector<float> vertices(std::begin(moonBoxVertices), std::end(moonBoxVertices));
-		std::vector<unsigned> indices(std::begin(moonBoxIndices), std::end(moonBoxIndices));
-		for (auto k = 4; k--;)
-			subdivideIcosphere(vertices, indices);
+	if(this->impostors)
+	{
+		this->impostorVAO.create();
+		QOpenGLVertexArrayObject::Binder boundVAO{&this->impostorVAO};
 
 		glEnableVertexAttribArray(0);
 
-		this->moonBoxVertexBuffer.create();
-		glBindBuffer(GL_ARRAY_BUFFER, this->moonBoxVertexBuffer.bufferId());
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+		this->impostorVertexBuffer.create();
+		glBindBuffer(GL_ARRAY_BUFFER, this->impostorVertexBuffer.bufferId());
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quadCorners), quadCorners, GL_STATIC_DRAW);
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
 
-		this->moonBoxIndexBuffer.create();
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->moonBoxIndexBuffer.bufferId());
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned) * indices.size(), indices.data(), GL_STATIC_DRAW);
-	}
+		// per body attributes, advanced once per instance and pointed at the frame's range before drawing
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer.bufferId());
 
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(BodyInstance), reinterpret_cast<void *>(offsetof(BodyInstance, sphere)));
+		glVertexAttribDivisor(1, 1);
 
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(BodyInstance), reinterpret_cast<void *>(offsetof(BodyInstance, layer)));
+		glVertexAttribDivisor(2, 1);
+	}
+	else
+	{
+		PROFILE_ZONE("load icosphere");
+		this->icosphereVAO.create();
+		QOpenGLVertexArrayObject::Binder boundVAO{ &this->icosphereVAO };
 
+		TaskScheduler::global().wait(meshTask);
+		auto const & mesh = *generatedMesh;
+		this->icosphereLevels = mesh.levels();
 
+		glEnableVertexAttribArray(0);
 
+		this->icosphereVertexBuffer.create();
+		glBindBuffer(GL_ARRAY_BUFFER, this->icosphereVertexBuffer.bufferId());
+		glBufferData(GL_ARRAY_BUFFER, 2 * sizeof(std::int16_t) * mesh.vertexCount(), mesh.vertices(), GL_STATIC_DRAW);
 
+		// octahedral encoded unit vectors, passed as integers since normalized shorts are converted differently before OpenGL 4.2
+		glVertexAttribIPointer(0, 2, GL_SHORT, 0, nullptr);
 
-	GLuint pid;
-	GLint loc;
+		// per body attributes, advanced once per instance and pointed at the frame's range before drawing
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer.bufferId());
 
-	this->icosahedronProgram.create();
-	this->icosahedronProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/icosahedron.frag");
-	this->icosahedronProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/icosahedron.vert");
-	this->icosahedronProgram.link();
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(BodyInstance), reinterpret_cast<void *>(offsetof(BodyInstance, sphere)));
+		glVertexAttribDivisor(1, 1);
 
-	pid = this->icosahedronProgram.programId();
-	glBindAttribLocation(pid, 0, "position");
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(BodyInstance), reinterpret_cast<void *>(offsetof(BodyInstance, layer)));
+		glVertexAttribDivisor(2, 1);
 
-	glUseProgram(pid);
-	loc = glGetUniformLocation(pid, "colorTexture");
-	glUniform1i(loc, 0);
+		this->icosphereIndexBuffer.create();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->icosphereIndexBuffer.bufferId());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexSize() * mesh.indexCount(), mesh.indices(), GL_STATIC_DRAW);
+		this->icosphereIndexSize = mesh.indexSize();
+		this->icosphereIndexType = mesh.indexSize() == sizeof(std::uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	}
 
-	this->skyboxProgram.create();
-	this->skyboxProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/skybox.frag");
-	this->skyboxProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/skybox.vert");
-	this->skyboxProgram.link();
+	if(!settings.replayPath.empty())
+	{
+		this->replay.reset(new RecordingReader{QString::fromStdString(settings.replayPath)});
+		if(this->replay->isValid() && this->replay->stepCount() > 0)
+		{
+			this->replay->readStep(0, this->renderState);
+			this->replayClock.start();
+			return;
+		}
 
-	pid = this->skyboxProgram.programId();
-	glBindAttribLocation(pid, 0, "position");
-	glUseProgram(pid);
+		qWarning() << "Could not read the recording" << QString::fromStdString(settings.replayPath) << "- simulating instead";
+		this->replay.reset();
+	}
 
-	loc = glGetUniformLocation(pid, "skyboxTexture");
-	glUniform1i(loc, 0);
+	this->renderState = createEarthMoonState();
+	{
+		PROFILE_ZONE("create simulation");
 
+		auto step = createGravityStep(this->renderState.size(), settings.integrator, 1., 0.01);
+		if(!step)
+			step = createGravityStep(this->renderState.size(), ExampleRendererSettings().integrator, 1., 0.01);
+		this->simulation.reset(new Simulation{this->renderState, step});
+	}
+	// queued, so the scheduler on the renderer's thread sees it
+	this->simulation->setPublishCallback([this] {
+		QMetaObject::invokeMethod(this, "frameRequested", Qt::QueuedConnection);
+	});
+	if(!settings.recordPath.empty())
+	{
+		// owned by the step callback, so it is finished when the simulation thread is gone
+		std::shared_ptr<RecordingWriter> recorder{new RecordingWriter{QString::fromStdString(settings.recordPath), this->renderState, this->simulation->timeStep()}};
+		if(recorder->isOpen())
+			this->simulation->setStepCallback([recorder] (BodyState const & state) { recorder->append(state); });
+		else
+			qWarning() << "Could not open" << QString::fromStdString(settings.recordPath) << "for recording";
+	}
+	this->simulation->start();
+}
 
+void ExampleRenderer::resize(int w, int h)
+{
+	this->projectionMatrix = calculateInfinitePerspective(
+		0.78539816339744831, // 45 degrees in radians
+		static_cast<double>(w) / h,
+		0.01 // near plane (chosen "at random")
+	);
+	this->inverseProjectionMatrix = this->projectionMatrix.inverse();
+	this->viewportHeight = h;
+	this->projectionChanged = true;
+	emit this->frameRequested();
+}
 
+bool ExampleRenderer::isLoading() const
+{
+	return !this->textureLoader.isIdle();
+}
 
-	this->moonBox.create();
-	this->moonBox.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/icosahedron.frag");
-	this->moonBox.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/icosahedron.vert");
-	this->moonBox.link();
+void ExampleRenderer::setPaused(bool paused)
+{
+	if(this->simulation)
+		this->simulation->setPaused(paused);
 
-	pid = this->moonBox.programId();
-	glBindAttribLocation(pid, 0, "position");
-	glUseProgram(pid);
+	this->replayPlaying = !paused;
+	this->replayClock.restart();
+	emit this->frameRequested();
+}
 
-	loc = glGetUniformLocation(pid, "skyboxTexture");
-	glUniform1i(loc, 0);
+void ExampleRenderer::seekTimeline(int step)
+{
+	if(!this->replay)
+		return;
 
+	this->replayTime = step * this->replay->timeStep();
+	this->replayClock.restart();
+	emit this->frameRequested();
+}
 
+std::vector<double> ExampleRenderer::takeSimulationStepTimes()
+{
+	return this->simulation ? this->simulation->takeStepTimes() : std::vector<double>{};
+}
 
+// advances the playback clock and interpolates between the two recorded steps around it
+void ExampleRenderer::updateReplayState()
+{
+	auto dt = this->replay->timeStep();
+	auto last = this->replay->stepCount() - 1;
+	if(this->replayPlaying)
+		this->replayTime += 1e-9 * this->replayClock.nsecsElapsed();
+	this->replayClock.restart();
+	this->replayTime = std::fmax(0., std::fmin(this->replayTime, last * dt));
+
+	auto step = std::min(static_cast<std::int64_t>(this->replayTime / dt), last);
+	auto alpha = this->replayTime / dt - step;
+	this->replay->readStep(step, this->renderState);
+	if(step < last && alpha > 0 && this->replay->readStep(step + 1, this->replayNext))
+	{
+		this->renderState.position += alpha * (this->replayNext.position - this->renderState.position);
+		this->renderState.time += alpha * (this->replayNext.time - this->renderState.time);
+	}
 
+	if(step != this->replayStep)
+	{
+		this->replayStep = step;
+		emit this->timelineChanged(static_cast<int>(step), static_cast<int>(last + 1));
+	}
+	if(this->replayPlaying && step < last)
+		emit this->frameRequested();
+}
 
-	this->earthTexture.create();
-	this->earthTexture.bind();
-	this->earthTexture.setData(QImage(":/textures/earth_color.jpg"));
-	this->earthTexture.setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
-	this->earthTexture.setMagnificationFilter(QOpenGLTexture::Linear);
-	this->earthTexture.setWrapMode(QOpenGLTexture::DirectionS, QOpenGLTexture::Repeat);
-	this->earthTexture.setWrapMode(QOpenGLTexture::DirectionT, QOpenGLTexture::ClampToEdge);
-	if(GLAD_GL_EXT_texture_filter_anisotropic)
-		this->earthTexture.setMaximumAnisotropy(16.f);
-	this->earthTexture.release();
+// after loading and whenever the shader manager replaced programs
+void ExampleRenderer::queryUniformLocations()
+{
+	GLuint pid;
+	GLint loc;
 
+	if(this->bodyProgram)
+	{
+		pid = this->bodyProgram->id();
+
+		glUseProgram(pid);
+		loc = glGetUniformLocation(pid, "colorTextures");
+		glUniform1i(loc, 0);
+		this->bodyViewProjectionLocation = glGetUniformLocation(pid, "viewProjection");
+	}
 
+	if(this->impostorProgram)
 	{
-		auto
-			px = QImage(":/textures/stars_px.jpg").convertToFormat(QImage::Format_RGBA8888).mirrored(),
-			py = QImage(":/textures/stars_py.jpg").convertToFormat(QImage::Format_RGBA8888).mirrored(),
-			pz = QImage(":/textures/stars_pz.jpg").convertToFormat(QImage::Format_RGBA8888).mirrored(),
-			nx = QImage(":/textures/stars_nx.jpg").convertToFormat(QImage::Format_RGBA8888).mirrored(),
-			ny = QImage(":/textures/stars_ny.jpg").convertToFormat(QImage::Format_RGBA8888).mirrored(),
-			nz = QImage(":/textures/stars_nz.jpg").convertToFormat(QImage::Format_RGBA8888).mirrored();
+		pid = this->impostorProgram->id();
 
-		this->skyboxTexture.create();
-		auto id = this->skyboxTexture.textureId();
-		this->skyboxTexture.bind();
-		this->skyboxTexture.setSize(px.width(), py.height());
-		this->skyboxTexture.setFormat(QOpenGLTexture::RGBA8_UNorm);
-		this->skyboxTexture.allocateStorage();
-		this->skyboxTexture.setData(0, 0, QOpenGLTexture::CubeMapPositiveX, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, px.constBits());
-		this->skyboxTexture.setData(0, 0, QOpenGLTexture::CubeMapPositiveY, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, py.constBits());
-		this->skyboxTexture.setData(0, 0, QOpenGLTexture::CubeMapPositiveZ, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, pz.constBits());
-		this->skyboxTexture.setData(0, 0, QOpenGLTexture::CubeMapNegativeX, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, nx.constBits());
-		this->skyboxTexture.setData(0, 0, QOpenGLTexture::CubeMapNegativeY, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, ny.constBits());
-		this->skyboxTexture.setData(0, 0, QOpenGLTexture::CubeMapNegativeZ, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, nz.constBits());
-		this->skyboxTexture.generateMipMaps();
-		this->skyboxTexture.setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
-		this->skyboxTexture.setMagnificationFilter(QOpenGLTexture::Linear);
-		if(GLAD_GL_EXT_texture_filter_anisotropic)
-			this->skyboxTexture.setMaximumAnisotropy(16.f);
-		this->skyboxTexture.release();
+		glUseProgram(pid);
+		loc = glGetUniformLocation(pid, "colorTextures");
+		glUniform1i(loc, 0);
+		this->impostorViewLocation = glGetUniformLocation(pid, "view");
+		this->impostorProjectionLocation = glGetUniformLocation(pid, "projection");
+		this->impostorInverseViewRotationLocation = glGetUniformLocation(pid, "inverseViewRotation");
 	}
 
-	this->MoonTexture.create();
-	this->MoonTexture.bind();
-	this->MoonTexture.setData(QImage(":/textures/moon_color.jpg"));
-	this->MoonTexture.setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
-	this->MoonTexture.setMagnificationFilter(QOpenGLTexture::Linear);
-	this->MoonTexture.setWrapMode(QOpenGLTexture::DirectionS, QOpenGLTexture::Repeat);
-	this->MoonTexture.setWrapMode(QOpenGLTexture::DirectionT, QOpenGLTexture::ClampToEdge);
-	if (GLAD_GL_EXT_texture_filter_anisotropic)
-		this->MoonTexture.setMaximumAnisotropy(16.f);
-	this->MoonTexture.release();
+	pid = this->skyboxProgram->id();
+	glUseProgram(pid);
 
+	loc = glGetUniformLocation(pid, "skyboxTexture");
+	glUniform1i(loc, 0);
+
+	glUseProgram(0);
 }
 
-void ExampleRenderer::resize(int w, int h)
+void ExampleRenderer::uploadFinishedTextures()
 {
-	this->projectionMatrix = calculateInfinitePerspective(
-		0.78539816339744831, // 45 degrees in radians
-		static_cast<double>(w) / h,
-		0.01 // near plane (chosen "at random")
-	);
-	this->inverseProjectionMatrix = this->projectionMatrix.inverse();
+	for(auto const & result : this->textureLoader.takeFinished())
+	{
+		if(result.id >= firstSkyboxFaceId)
+		{
+			// a face that failed to load leaves the sky black
+			auto face = static_cast<QOpenGLTexture::CubeMapFace>(QOpenGLTexture::CubeMapPositiveX + result.id - firstSkyboxFaceId);
+			this->skyboxTexture.bind();
+			if(uploadTextureLevels(this->skyboxTexture, 0, face, result.texture))
+				--this->skyboxFacesPending;
+			this->skyboxTexture.release();
+		}
+		else
+		{
+			this->bodyTextures.bind();
+			this->bodyLayerReady[result.id] = uploadTextureLevels(this->bodyTextures, result.id, QOpenGLTexture::CubeMapPositiveX, result.texture);
+			this->bodyTextures.release();
+		}
+	}
 }
 
 void ExampleRenderer::render()
 {
+	PROFILE_ZONE("ExampleRenderer::render");
+
+	if(this->gpuProfiler.beginFrame())
+		emit this->gpuTimingsChanged(this->gpuProfiler.timings());
+
+	if(this->shaders.reloadChanged())
+		this->queryUniformLocations();
+
+	{
+		PROFILE_ZONE("texture upload");
+		GpuProfiler::Scope pass{this->gpuProfiler, "texture upload"};
+		this->uploadFinishedTextures();
+	}
+
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
 
@@ -381,59 +514,194 @@ void ExampleRenderer::render()
 
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-	glClear(GL_DEPTH_BUFFER_BIT);
+	if(this->skyboxFacesPending > 0)
+	{
+		glClearColor(0, 0, 0, 1);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+	else
+		glClear(GL_DEPTH_BUFFER_BIT);
 
 	{
-		auto sa = std::sin(this->cameraAzimuth);
-		auto ca = std::cos(this->cameraAzimuth);
-		auto se = std::sin(this->cameraElevation);
-		auto ce = std::cos(this->cameraElevation);
-		viewMatrix = calculateLookAtMatrix(
-			{4 * se * ca, 4 * se * sa, 4 * ce},
-			{0, 0, 0},
-			{ -ce * ca, -ce * sa, se }
-		);
-		inverseViewMatrix = viewMatrix.inverse();
+		PROFILE_ZONE("interpolate state");
+		if(this->replay)
+			this->updateReplayState();
+		else
+			this->simulation->interpolatedState(this->renderState);
 	}
-	
-	translation << 1, 0, 0, Verschiebung::counter, 0, 1, 0, 5, 0, 0, 1, 0, 0, 0, 0, 1;
-	scale_earth << 0.5, 0, 0, 0, 0, 0.5, 0, 0, 0, 0, 0.5, 0, 0, 0, 0, 1;
-	scale_moon << 0.25, 0, 0, 0, 0, 0.25, 0, 0, 0, 0, 0.25, 0, 0, 0, 0, 1;
 	{
-		QOpenGLVertexArrayObject::Binder boundVAO{&this->icosahedronVAO};
+		PROFILE_ZONE("update scene");
+		auto n = this->renderState.size();
+		while(this->bodyNodes.size() < static_cast<std::size_t>(n))
+			this->bodyNodes.push_back(this->scene.addNode(SceneGraph::root, Eigen::Affine3d::Identity(), 1));
+
+		// unit spheres scaled to the body radius
+		parallelFor(0, n, 4096, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+			for(auto i = first; i < last; ++i)
+			{
+				Eigen::Vector3d center = this->renderState.position.row(i).transpose();
+				this->scene.setLocalTransform(this->bodyNodes[i], Eigen::Translation3d{center} * Eigen::Scaling(this->renderState.radius(i)));
+			}
+		});
+		this->scene.update();
+
+		if(this->projectionChanged || this->scene.wasUpdated(this->camera))
+		{
+			auto const & cameraToWorld = this->scene.worldTransform(this->camera);
+			this->inverseViewMatrix = cameraToWorld.matrix();
+			this->viewMatrix = cameraToWorld.inverse(Eigen::Isometry).matrix();
+
+			Eigen::Matrix4d viewProjection = this->projectionMatrix * this->viewMatrix;
+			this->viewProjection = viewProjection.cast<float>();
+			this->frustum = Frustum{viewProjection};
+			this->projectionChanged = false;
+		}
+	}
 
-		auto pid = this->icosahedronProgram.programId();
-		GLint loc;
+	// pixels covered by a unit length at unit distance
+	auto pixelScale = 0.5 * this->viewportHeight * this->projectionMatrix(1, 1);
 
-		glUseProgram(pid);
+	{
+		PROFILE_ZONE("prepare instances");
+		auto n = this->renderState.size();
+		PROFILE_COUNTER("bodies", n);
+		// impostors have no levels of detail, they all go into the range of level 0
+		auto levels = this->impostors ? std::size_t{1} : this->icosphereLevels.size();
+		Eigen::Vector3d eye = this->inverseViewMatrix.col(3).head<3>();
+
+		this->bodyLevels.resize(n);
+		parallelFor(0, n, 4096, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+			for(auto i = first; i < last; ++i)
+			{
+				auto const & sphere = this->scene.worldBounds(this->bodyNodes[i]);
+				if(!this->frustum.intersects(sphere))
+				{
+					this->bodyLevels[i] = -1;
+					continue;
+				}
+
+				if(this->impostors)
+				{
+					this->bodyLevels[i] = 0;
+					continue;
+				}
+
+				auto distance = (sphere.center - eye).norm();
+				this->bodyLevels[i] = distance > sphere.radius ? selectIcosphereLevel(this->icosphereLevels, pixelScale * sphere.radius / distance) : static_cast<int>(levels) - 1;
+			}
+		});
+
+		this->levelInstanceCounts.assign(levels, 0);
+		for(auto level : this->bodyLevels)
+			if(level >= 0)
+				++this->levelInstanceCounts[level];
+
+		// counting sort by level, so the instances of each level form one contiguous range
+		this->levelFirstInstance.resize(levels);
+		GLsizei visible = 0;
+		for(std::size_t level = 0; level < levels; ++level)
+		{
+			this->levelFirstInstance[level] = visible;
+			visible += this->levelInstanceCounts[level];
+		}
+		PROFILE_COUNTER("visible bodies", visible);
+
+		this->instances.resize(visible);
+		this->levelCursor = this->levelFirstInstance;
+		for(Eigen::Index i = 0; i < n; ++i)
+		{
+			if(this->bodyLevels[i] < 0)
+				continue;
+
+			auto const & sphere = this->scene.worldBounds(this->bodyNodes[i]);
+			auto & instance = this->instances[this->levelCursor[this->bodyLevels[i]]++];
+			for(int c = 0; c < 3; ++c)
+				instance.sphere[c] = static_cast<GLfloat>(sphere.center(c));
+			instance.sphere[3] = static_cast<GLfloat>(sphere.radius);
+			// negative layers select the placeholder color in the shader
+			auto layer = this->renderState.texture(i);
+			instance.layer = layer >= 0 && layer < bodyTextureCount && this->bodyLayerReady[layer] ? static_cast<GLfloat>(layer) : -1.f;
+		}
+
+		GpuProfiler::Scope pass{this->gpuProfiler, "instance upload"};
+		// a new region of the ring every frame, draws of earlier frames may still read theirs
+		this->instanceOffset = this->instanceBuffer.write(this->instances.data(), sizeof(BodyInstance) * visible);
+	}
+	if(this->impostors)
+	{
+		PROFILE_ZONE("draw bodies");
+		GpuProfiler::Scope pass{this->gpuProfiler, "bodies"};
+		QOpenGLVertexArrayObject::Binder boundVAO{&this->impostorVAO};
+
+		glUseProgram(this->impostorProgram->id());
 
 		glActiveTexture(GL_TEXTURE0 + 0);
-		glBindTexture(this->earthTexture.target(), this->earthTexture.textureId());
+		glBindTexture(this->bodyTextures.target(), this->bodyTextures.textureId());
 
-		loc = glGetUniformLocation(pid, "modelViewProjection");
-	    glUniformMatrix4fv(loc, 1, GL_FALSE, ( this->projectionMatrix * this->viewMatrix* this->scale_earth).cast<float>().eval().data());
+		Eigen::Matrix4f view = this->viewMatrix.cast<float>();
+		Eigen::Matrix4f projection = this->projectionMatrix.cast<float>();
+		Eigen::Matrix3f inverseViewRotation = this->inverseViewMatrix.topLeftCorner<3, 3>().cast<float>();
+		glUniformMatrix4fv(this->impostorViewLocation, 1, GL_FALSE, view.data());
+		glUniformMatrix4fv(this->impostorProjectionLocation, 1, GL_FALSE, projection.data());
+		glUniformMatrix3fv(this->impostorInverseViewRotationLocation, 1, GL_FALSE, inverseViewRotation.data());
 
-		glDrawElements(GL_TRIANGLES, std::pow(4, 4) * sizeof(icosahedronIndices) / sizeof(icosahedronIndices[0]), GL_UNSIGNED_INT, nullptr);
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer.bufferId());
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(BodyInstance), reinterpret_cast<void *>(this->instanceOffset + offsetof(BodyInstance, sphere)));
+		glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(BodyInstance), reinterpret_cast<void *>(this->instanceOffset + offsetof(BodyInstance, layer)));
 
-	
-		//Verschiebung::counter += 0.01;
-		glUseProgram(pid);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, this->levelInstanceCounts[0]);
+	}
+	else
+	{
+		PROFILE_ZONE("draw bodies");
+		GpuProfiler::Scope pass{this->gpuProfiler, "bodies"};
+		QOpenGLVertexArrayObject::Binder boundVAO{&this->icosphereVAO};
+
+		glUseProgram(this->bodyProgram->id());
 
 		glActiveTexture(GL_TEXTURE0 + 0);
-		glBindTexture(this->MoonTexture.target(), this->MoonTexture.textureId());
+		glBindTexture(this->bodyTextures.target(), this->bodyTextures.textureId());
 
-		loc = glGetUniformLocation(pid, "modelViewProjection");
-		glUniformMatrix4fv(loc, 1, GL_FALSE, (this->projectionMatrix * this->viewMatrix * this->scale_moon * this->translation).cast<float>().eval().data());
+		glUniformMatrix4fv(this->bodyViewProjectionLocation, 1, GL_FALSE, this->viewProjection.data());
+
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer.bufferId());
+		for(std::size_t level = 0; level < this->icosphereLevels.size(); ++level)
+		{
+			auto count = this->levelInstanceCounts[level];
+			if(count == 0)
+				continue;
+
+			// OpenGL 3.3 has no base instance, so the instance attributes are pointed at the level's range instead
+			auto offset = this->instanceOffset + sizeof(BodyInstance) * this->levelFirstInstance[level];
+			glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(BodyInstance), reinterpret_cast<void *>(offset + offsetof(BodyInstance, sphere)));
+			glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(BodyInstance), reinterpret_cast<void *>(offset + offsetof(BodyInstance, layer)));
+
+			auto const & lod = this->icosphereLevels[level];
+			glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(lod.indexCount), this->icosphereIndexType, reinterpret_cast<void *>(this->icosphereIndexSize * lod.indexOffset), count);
+		}
+	}
+	// every draw reading this frame's instances is issued
+	this->instanceBuffer.finishFrame();
 
-		glDrawElements(GL_TRIANGLES, std::pow(4, 4) * sizeof(icosahedronIndices) / sizeof(icosahedronIndices[0]), GL_UNSIGNED_INT, nullptr);
+	if(this->particleCount > 0)
+	{
+		PROFILE_ZONE("draw particles");
+		GpuProfiler::Scope pass{this->gpuProfiler, "particles"};
+		if(!this->particles)
+			this->particles.reset(new ParticleSystem{this->shaders, this->particleCount, this->renderState});
 
+		this->particles->advance(this->renderState);
+		this->particles->render(this->viewProjection, static_cast<float>(pixelScale));
 	}
 
 	glCullFace(GL_FRONT);
+	if(this->skyboxFacesPending == 0)
 	{
+		PROFILE_ZONE("draw skybox");
+		GpuProfiler::Scope pass{this->gpuProfiler, "skybox"};
 		QOpenGLVertexArrayObject::Binder boundVAO{ &this->skyboxVAO };
 
-		auto pid = this->skyboxProgram.programId();
+		auto pid = this->skyboxProgram->id();
 		auto tid = this->skyboxTexture.textureId();
 		GLint loc;
 
@@ -443,12 +711,18 @@ void ExampleRenderer::render()
 		glBindTexture(this->skyboxTexture.target(), this->skyboxTexture.textureId());
 
 		loc = glGetUniformLocation(pid, "modelViewProjection");
-		glUniformMatrix4fv(loc, 1, GL_FALSE, (this->projectionMatrix * this->viewMatrix).cast<float>().eval().data());
+		glUniformMatrix4fv(loc, 1, GL_FALSE, this->viewProjection.data());
 
 		glDrawElements(GL_TRIANGLES, sizeof(cubeIndices) / sizeof(cubeIndices[0]), GL_UNSIGNED_BYTE, nullptr);
 	}
 
 	glUseProgram(0);
+
+	this->gpuProfiler.endFrame();
+
+	// keep drawing until every texture has arrived, nothing else would ask for the frame that uploads them
+	if(this->isLoading())
+		emit this->frameRequested();
 }
 
 void ExampleRenderer::mouseEvent(QMouseEvent * e)
@@ -476,7 +750,9 @@ void ExampleRenderer::mouseEvent(QMouseEvent * e)
 		cameraAzimuth = std::fmod(cameraAzimuth, 6.283185307179586476925286766559);
 		cameraElevation -= 0.01 * delta.y();
 		cameraElevation = std::fmax(std::fmin(cameraElevation, 3.1415926535897932384626433832795), 0);
+		this->scene.setLocalTransform(this->cameraPivot, calculateOrbitRotation(cameraAzimuth, cameraElevation));
 
 		this->lastPos = pos;
+		emit this->frameRequested();
 	}
 }
@@ -1,56 +1,157 @@
 #pragma once
 
+#include "GpuProfiler.hpp"
+#include "Icosphere.hpp"
 #include "OpenGLRenderer.hpp"
+#include "ParticleSystem.hpp"
+#include "SceneGraph.hpp"
+#include "ShaderManager.hpp"
+#include "Simulation.hpp"
+#include "SimulationRecording.hpp"
+#include "StreamingBuffer.hpp"
+#include "TextureLoader.hpp"
 
 #include <glad/glad.h>
 
+#include <QElapsedTimer>
 #include <QOpenGLBuffer>
-#include <QOpenGLShaderProgram>
 #include <QOpenGLTexture>
 #include <QOpenGLVertexArrayObject>
 
 #include <Eigen/Core>
 
-#include "Verschiebung.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ExampleRendererSettings
+{
+	enum class BodyRenderer
+	{
+		// instanced icospheres with distance based levels of detail
+		Mesh,
+		// screen aligned quads, ray cast against the sphere per fragment
+		Impostor
+	};
+
+	// one of integratorNames()
+	std::string integrator = "verlet";
+	// records every simulation step to this file if not empty
+	std::string recordPath;
+	// plays back a recording instead of simulating if not empty
+	std::string replayPath;
+	BodyRenderer bodyRenderer = BodyRenderer::Mesh;
+	// shaders are read from this directory (if they exist there) and reloaded when they change, instead of only from the resources
+	std::string shaderDirectory;
+	// asteroid belt particles integrated on the GPU, none if zero
+	std::size_t particleCount = 0;
+};
+
 class ExampleRenderer : public OpenGLRenderer
 {
 	Q_OBJECT
 
 public:
-	ExampleRenderer(QObject * parent);
+	ExampleRenderer(QObject * parent, ExampleRendererSettings settings = ExampleRendererSettings());
 
 	void resize(int w, int h) override;
 	void render() override;
 
 	void mouseEvent(QMouseEvent * e) override;
 
+	bool isLoading() const override;
+	void setPaused(bool paused) override;
+	void seekTimeline(int step) override;
+	std::vector<double> takeSimulationStepTimes() override;
+
 private:
+	void queryUniformLocations();
+	void uploadFinishedTextures();
+	void updateReplayState();
+
 	double cameraAzimuth, cameraElevation;
 	bool rotateInteraction;
 	QPointF lastPos;
+	int viewportHeight;
 
 	Eigen::Matrix4d
 		projectionMatrix, inverseProjectionMatrix,
-		viewMatrix, inverseViewMatrix, translation, scale_earth, scale_moon;
+		viewMatrix, inverseViewMatrix;
+	// derived from the matrices above, only recomputed when the camera or the viewport changed
+	Eigen::Matrix4f viewProjection;
+	Frustum frustum;
+	bool projectionChanged;
+
+	// the camera is a child of a pivot at the origin that the user rotates, bodies hang directly below the root since the simulation works in world space
+	SceneGraph scene;
+	SceneGraph::Node cameraPivot, camera;
+	// node of body i
+	std::vector<SceneGraph::Node> bodyNodes;
+
+	// per instance vertex attributes of the body pass
+	struct BodyInstance
+	{
+		GLfloat sphere[4]; // center and radius
+		GLfloat layer;
+	};
+	std::vector<BodyInstance> instances;
+	// where this frame's instances start in the instance buffer
+	std::size_t instanceOffset;
+
+	// level of detail chosen for every body (-1 if outside the view) and the instance range of every level
+	std::vector<int> bodyLevels;
+	std::vector<GLsizei> levelInstanceCounts, levelFirstInstance, levelCursor;
 
 	QOpenGLBuffer
-		icosahedronVertexBuffer, icosahedronIndexBuffer,
-		skyboxVertexBuffer, skyboxIndexBuffer,
-		moonBoxVertexBuffer, moonBoxIndexBuffer;
+		icosphereVertexBuffer, icosphereIndexBuffer,
+		skyboxVertexBuffer, skyboxIndexBuffer;
+	StreamingBuffer instanceBuffer;
+
+	std::vector<IcosphereLevel> icosphereLevels;
+	// 16 or 32 bit, see IcosphereMesh
+	GLenum icosphereIndexType;
+	std::size_t icosphereIndexSize;
 
+	// impostor mode has no icosphere, every visible body is one quad
+	bool impostors;
+	QOpenGLBuffer impostorVertexBuffer;
 
 	QOpenGLVertexArrayObject
-		icosahedronVAO,
-		skyboxVAO,
-		moonBoxVAO;
+		icosphereVAO,
+		impostorVAO,
+		skyboxVAO;
 
-	QOpenGLShaderProgram
-		icosahedronProgram,
-		skyboxProgram,
-		moonBox;
+	// programs are owned by the manager, only the one for the chosen body renderer is loaded
+	ShaderManager shaders;
+	ShaderManager::Program const
+		* bodyProgram,
+		* impostorProgram,
+		* skyboxProgram;
+
+	GLint bodyViewProjectionLocation;
+	GLint impostorViewLocation, impostorProjectionLocation, impostorInverseViewRotationLocation;
 
 	QOpenGLTexture
-		earthTexture,
-		skyboxTexture,
-		MoonTexture;
+		bodyTextures,
+		skyboxTexture;
+
+	GpuProfiler gpuProfiler;
+
+	// created with the first frame, once the state the belt orbits is known
+	std::size_t particleCount;
+	std::unique_ptr<ParticleSystem> particles;
+
+	TextureLoader textureLoader;
+	std::vector<bool> bodyLayerReady;
+	int skyboxFacesPending;
+
+	// exactly one of simulation and replay is set
+	std::unique_ptr<Simulation> simulation;
+	std::unique_ptr<RecordingReader> replay;
+	BodyState renderState, replayNext;
+	double replayTime;
+	bool replayPlaying;
+	std::int64_t replayStep;
+	QElapsedTimer replayClock;
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "FrameScheduler.hpp"
+
+#include <cmath>
+
+FrameScheduler::FrameScheduler(QObject * parent)
+	: QObject{parent}
+	, currentMode{Mode::OnDemand}
+	, cap{60}
+	, requested{false}
+	, drawing{false}
+	, due{false}
+	// a child, so moveToThread takes the timer along
+	, timer{this}
+{
+	this->timer.setSingleShot(true);
+	this->timer.setTimerType(Qt::PreciseTimer);
+	this->connect(&this->timer, &QTimer::timeout, this, &FrameScheduler::trigger);
+}
+
+FrameScheduler::Mode FrameScheduler::mode() const
+{
+	return this->currentMode;
+}
+
+void FrameScheduler::setMode(Mode mode)
+{
+	this->currentMode = mode;
+	// kick off the new mode, a continuous loop would otherwise wait for a request
+	this->requestFrame();
+	this->schedule();
+}
+
+double FrameScheduler::frameRateCap() const
+{
+	return this->cap;
+}
+
+void FrameScheduler::setFrameRateCap(double framesPerSecond)
+{
+	this->cap = std::fmax(framesPerSecond, 0.);
+}
+
+QString FrameScheduler::modeName(Mode mode)
+{
+	switch(mode)
+	{
+	case Mode::Continuous:
+		return QStringLiteral("continuous");
+	case Mode::Paced:
+		return QStringLiteral("paced");
+	case Mode::OnDemand:
+		return QStringLiteral("on-demand");
+	}
+	return {};
+}
+
+bool FrameScheduler::parseMode(QString const & name, Mode & mode)
+{
+	for(auto candidate : {Mode::Continuous, Mode::Paced, Mode::OnDemand})
+	{
+		if(name == modeName(candidate))
+		{
+			mode = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+void FrameScheduler::requestFrame()
+{
+	this->requested = true;
+	// requests during a frame are handled when it finishes
+	if(!this->drawing)
+		this->schedule();
+}
+
+void FrameScheduler::frameStarted()
+{
+	this->drawing = true;
+	this->requested = false;
+	this->due = false;
+	this->sinceFrameStart.start();
+}
+
+void FrameScheduler::frameFinished()
+{
+	this->drawing = false;
+	if(this->currentMode == Mode::Continuous)
+		this->trigger();
+	else if(this->currentMode == Mode::Paced || this->requested)
+		this->schedule();
+}
+
+void FrameScheduler::schedule()
+{
+	if(this->due || this->timer.isActive())
+		return;
+
+	if(this->currentMode == Mode::Continuous || this->cap <= 0 || !this->sinceFrameStart.isValid())
+	{
+		this->trigger();
+		return;
+	}
+
+	auto remaining = 1e3 / this->cap - this->sinceFrameStart.nsecsElapsed() * 1e-6;
+	if(remaining <= 0)
+		this->trigger();
+	else
+		this->timer.start(static_cast<int>(std::ceil(remaining)));
+}
+
+void FrameScheduler::trigger()
+{
+	this->due = true;
+	emit this->frameDue();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+// decides when the next frame is drawn: continuous renders back to back (bounded only by vsync), paced waits for the frame rate cap,
+// on-demand only draws after requestFrame() and also respects the cap
+class FrameScheduler : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum class Mode
+	{
+		Continuous,
+		Paced,
+		OnDemand
+	};
+
+	explicit FrameScheduler(QObject * parent = nullptr);
+
+	Mode mode() const;
+	void setMode(Mode mode);
+
+	// frames per second, 0 disables the cap
+	double frameRateCap() const;
+	void setFrameRateCap(double framesPerSecond);
+
+	static QString modeName(Mode mode);
+	static bool parseMode(QString const & name, Mode & mode);
+
+public slots:
+	void requestFrame();
+
+	// bracket every drawn frame
+	void frameStarted();
+	void frameFinished();
+
+signals:
+	// connect to QWidget::update or equivalent
+	void frameDue();
+
+private:
+	void schedule();
+	void trigger();
+
+	Mode currentMode;
+	double cap;
+	// requested: something changed since the last frame started, due: frameDue was emitted and the frame has not started yet
+	bool requested, drawing, due;
+	QElapsedTimer sinceFrameStart;
+	QTimer timer;
+};
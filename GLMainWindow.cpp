@@ -1,23 +1,114 @@
 #include "GLMainWindow.hpp"
 #include "ui_GLMainWindow.h"
+#include "Profiler.hpp"
+#include "RenderWindow.hpp"
 
 #ifdef _WIN32
 #include <QtPlatformHeaders/QWindowsWindowFunctions>
 #endif
 
+#include <QActionGroup>
+#include <QDebug>
+#include <QFileDialog>
 #include <QMessageBox>
+#include <QOpenGLContext>
 #include <QShortcut>
+#include <QSlider>
+#include <QToolBar>
 
-GLMainWindow::GLMainWindow(QWidget * parent, Qt::WindowFlags f)
+#include <algorithm>
+
+template<class Host>
+void GLMainWindow::connectRenderHost(Host * host)
+{
+	// forward signals
+	this->connect(host, &Host::loggingEnabledChanged, this, &GLMainWindow::openGLLoggingEnabledChanged);
+	this->connect(host, &Host::loggingSynchronousChanged, this, &GLMainWindow::openGLLoggingSynchronousChanged);
+
+	this->connect(host, &Host::gpuTimingsChanged, this, &GLMainWindow::updateGpuTimings);
+	this->connect(host, &Host::timelineChanged, this, &GLMainWindow::updateTimeline);
+	this->connect(this->timelineSlider, &QSlider::valueChanged, host, &Host::seekTimeline);
+}
+
+template<class Function>
+void GLMainWindow::withRenderHost(Function const & function)
+{
+	if(this->renderWindow)
+		function(this->renderWindow);
+	else
+		function(this->ui->openGLWidget);
+}
+
+GLMainWindow::GLMainWindow(RenderHost host, QWidget * parent, Qt::WindowFlags f)
 	: QMainWindow{parent, f}
 	, ui{new Ui::GLMainWindow}
+	, renderWindow{nullptr}
 {
 	this->ui->setupUi(this);
 	this->setWindowTitle(QApplication::applicationDisplayName());
 
-	// forward signals
-	this->connect(this->ui->openGLWidget, &OpenGLWidget::loggingEnabledChanged, this, &GLMainWindow::openGLLoggingEnabledChanged);
-	this->connect(this->ui->openGLWidget, &OpenGLWidget::loggingSynchronousChanged, this, &GLMainWindow::openGLLoggingSynchronousChanged);
+	if(host == RenderHost::Thread)
+	{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+		auto threadedOpenGL = QOpenGLContext::supportsThreadedOpenGL();
+#else
+		auto threadedOpenGL = true;
+#endif
+		if(threadedOpenGL)
+		{
+			this->renderWindow = new RenderWindow;
+			auto container = QWidget::createWindowContainer(this->renderWindow, this);
+			container->setMinimumSize(this->ui->openGLWidget->minimumSize());
+			// deletes the widget host
+			this->setCentralWidget(container);
+			this->ui->openGLWidget = nullptr;
+		}
+		else
+			qWarning() << "The platform cannot render on a separate thread, rendering on the GUI thread instead";
+	}
+
+	this->ui->menuView->addAction(this->ui->gpuTimingsDock->toggleViewAction());
+	this->ui->gpuTimingsDock->hide();
+	this->gpuTimingsRefresh.start();
+
+	// only shown while the renderer plays back a recording
+	this->timelineToolBar = new QToolBar{tr("Timeline"), this};
+	this->timelineToolBar->setObjectName("timelineToolBar");
+	this->timelineSlider = new QSlider{Qt::Horizontal, this->timelineToolBar};
+	this->timelineToolBar->addWidget(this->timelineSlider);
+	this->addToolBar(Qt::BottomToolBarArea, this->timelineToolBar);
+	this->timelineToolBar->hide();
+
+	if(this->renderWindow)
+		this->connectRenderHost(this->renderWindow);
+	else
+		this->connectRenderHost(this->ui->openGLWidget);
+
+	// exclusive frame scheduling modes, the menu follows the scheduler's current mode
+	{
+		auto group = new QActionGroup{this};
+		std::pair<QAction *, FrameScheduler::Mode> modes[] = {
+			{this->ui->actionFrameContinuous, FrameScheduler::Mode::Continuous},
+			{this->ui->actionFramePaced, FrameScheduler::Mode::Paced},
+			{this->ui->actionFrameOnDemand, FrameScheduler::Mode::OnDemand}
+		};
+		for(auto const & mode : modes)
+		{
+			group->addAction(mode.first);
+			auto value = mode.second;
+			this->connect(mode.first, &QAction::triggered, this, [this, value] { this->setFrameMode(value); });
+		}
+		if(this->renderWindow)
+		{
+			this->setFrameMode(this->renderWindow->frameMode());
+			this->setFrameRateCap(this->renderWindow->frameRateCap());
+		}
+		else
+		{
+			this->setFrameMode(this->ui->openGLWidget->frameScheduler()->mode());
+			this->setFrameRateCap(this->ui->openGLWidget->frameScheduler()->frameRateCap());
+		}
+	}
 
 	this->ui->actionExit->setShortcuts(QKeySequence::Quit);
 	this->ui->actionFullScreen->setShortcuts(QKeySequence::FullScreen);
@@ -39,12 +130,32 @@ GLMainWindow::~GLMainWindow() = default;
 
 void GLMainWindow::setRendererFactory(std::function<OpenGLRenderer * (QObject * parent)> rendererFactory)
 {
-	this->ui->openGLWidget->setRendererFactory(std::move(rendererFactory));
+	this->withRenderHost([&] (auto host) { host->setRendererFactory(rendererFactory); });
+}
+
+void GLMainWindow::setFrameMode(FrameScheduler::Mode mode)
+{
+	if(this->renderWindow)
+		this->renderWindow->setFrameMode(mode);
+	else
+		this->ui->openGLWidget->frameScheduler()->setMode(mode);
+	this->ui->actionFrameContinuous->setChecked(mode == FrameScheduler::Mode::Continuous);
+	this->ui->actionFramePaced->setChecked(mode == FrameScheduler::Mode::Paced);
+	this->ui->actionFrameOnDemand->setChecked(mode == FrameScheduler::Mode::OnDemand);
+}
+
+void GLMainWindow::setFrameRateCap(double framesPerSecond)
+{
+	if(this->renderWindow)
+		this->renderWindow->setFrameRateCap(framesPerSecond);
+	else
+		this->ui->openGLWidget->frameScheduler()->setFrameRateCap(framesPerSecond);
+	this->ui->actionFramePaced->setText(framesPerSecond > 0 ? tr("&Capped (%1 fps)").arg(framesPerSecond) : tr("&Capped"));
 }
 
 // forward slots
-void GLMainWindow::setOpenGLLoggingEnabled(bool enabled) { this->ui->openGLWidget->setLoggingEnabled(enabled); }
-void GLMainWindow::setOpenGLLoggingSynchronous(bool synchronous) { this->ui->openGLWidget->setLoggingSynchronous(synchronous); }
+void GLMainWindow::setOpenGLLoggingEnabled(bool enabled) { this->withRenderHost([enabled] (auto host) { host->setLoggingEnabled(enabled); }); }
+void GLMainWindow::setOpenGLLoggingSynchronous(bool synchronous) { this->withRenderHost([synchronous] (auto host) { host->setLoggingSynchronous(synchronous); }); }
 
 void GLMainWindow::on_actionFullScreen_toggled(bool checked)
 {
@@ -69,7 +180,7 @@ void GLMainWindow::on_actionFullScreenOpenGL_toggled(bool checked)
 		this->savedVisibilities.clear();
 		for(auto child : this->findChildren<QWidget *>(QString(), Qt::FindDirectChildrenOnly))
 		{
-			if(child == this->ui->openGLWidget)
+			if(child == this->centralWidget())
 				continue;
 
 			this->savedVisibilities[child] = child->isVisible();
@@ -80,7 +191,7 @@ void GLMainWindow::on_actionFullScreenOpenGL_toggled(bool checked)
 	{
 		for(auto child : this->findChildren<QWidget *>(QString(), Qt::FindDirectChildrenOnly))
 		{
-			if(child == this->ui->openGLWidget)
+			if(child == this->centralWidget())
 				continue;
 
 			auto it = this->savedVisibilities.find(child);
@@ -110,6 +221,62 @@ void GLMainWindow::on_actionAbout_triggered()
 	QMessageBox::about(this, tr("About %1").arg(QApplication::applicationDisplayName()), tr("This application is based on the simulation framework for the TU Darmstadt lecture on physically based animation."));
 }
 
+void GLMainWindow::on_actionPauseSimulation_toggled(bool checked)
+{
+	this->withRenderHost([checked] (auto host) { host->setSimulationPaused(checked); });
+}
+
+void GLMainWindow::on_actionRecordTrace_toggled(bool checked)
+{
+	Profiler::setEnabled(checked);
+}
+
+void GLMainWindow::on_actionSaveTrace_triggered()
+{
+	auto path = QFileDialog::getSaveFileName(this, tr("Save CPU Trace"), QStringLiteral("trace.json"), tr("Chrome Trace (*.json)"));
+	if(path.isEmpty())
+		return;
+
+	if(!Profiler::writeChromeTrace(path))
+		QMessageBox::warning(this, tr("Save CPU Trace"), tr("Could not write %1").arg(path));
+}
+
+void GLMainWindow::updateTimeline(int step, int stepCount)
+{
+	// programmatic updates must not seek back
+	QSignalBlocker blocker{this->timelineSlider};
+	this->timelineSlider->setRange(0, std::max(stepCount - 1, 0));
+	if(!this->timelineSlider->isSliderDown())
+		this->timelineSlider->setValue(step);
+	this->timelineToolBar->setVisible(stepCount > 1);
+}
+
+void GLMainWindow::updateGpuTimings(std::vector<GpuPassTiming> const & timings)
+{
+	// timings arrive every frame, a few updates per second are readable
+	if(!this->ui->gpuTimingsDock->isVisible() || this->gpuTimingsRefresh.elapsed() < 250)
+		return;
+	this->gpuTimingsRefresh.restart();
+
+	auto tree = this->ui->gpuTimingsTree;
+	while(tree->topLevelItemCount() > static_cast<int>(timings.size()))
+		delete tree->takeTopLevelItem(tree->topLevelItemCount() - 1);
+	while(tree->topLevelItemCount() < static_cast<int>(timings.size()))
+	{
+		auto item = new QTreeWidgetItem{tree};
+		item->setTextAlignment(1, Qt::AlignRight);
+		item->setTextAlignment(2, Qt::AlignRight);
+	}
+
+	for(std::size_t i = 0; i < timings.size(); ++i)
+	{
+		auto item = tree->topLevelItem(static_cast<int>(i));
+		item->setText(0, QString(2 * timings[i].depth, ' ') + QString::fromStdString(timings[i].name));
+		item->setText(1, QString::number(timings[i].lastMilliseconds, 'f', 3));
+		item->setText(2, QString::number(timings[i].averageMilliseconds, 'f', 3));
+	}
+}
+
 void GLMainWindow::fillActionShortcuts(QWidget * base)
 {
 	for(auto action : base->actions())
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "FrameScheduler.hpp"
+#include "OpenGLRenderer.hpp"
+
+#include <QElapsedTimer>
 #include <QMainWindow>
 
 #include <functional>
@@ -12,19 +16,31 @@ namespace Ui
 	class GLMainWindow;
 }
 
-class OpenGLRenderer;
 class QShortcut;
+class QSlider;
+class QToolBar;
+class RenderWindow;
 
 class GLMainWindow : public QMainWindow
 {
 	Q_OBJECT
 
 public:
-	GLMainWindow(QWidget * parent = nullptr, Qt::WindowFlags f = Qt::WindowFlags());
+	// where the renderer runs: in an OpenGLWidget on the GUI thread or in a RenderWindow with its own thread
+	enum class RenderHost
+	{
+		Widget,
+		Thread
+	};
+
+	explicit GLMainWindow(RenderHost host = RenderHost::Widget, QWidget * parent = nullptr, Qt::WindowFlags f = Qt::WindowFlags());
 	~GLMainWindow();
 
 	void setRendererFactory(std::function<OpenGLRenderer * (QObject * parent)> rendererFactory);
 
+	void setFrameMode(FrameScheduler::Mode mode);
+	void setFrameRateCap(double framesPerSecond);
+
 public slots:
 	void setOpenGLLoggingEnabled(bool enabled);
 	void setOpenGLLoggingSynchronous(bool synchronous);
@@ -37,12 +53,30 @@ private slots:
 	void on_actionFullScreen_toggled(bool checked);
 	void on_actionFullScreenOpenGL_toggled(bool checked);
 	void on_actionAbout_triggered();
+	void on_actionPauseSimulation_toggled(bool checked);
+	void on_actionRecordTrace_toggled(bool checked);
+	void on_actionSaveTrace_triggered();
+	void updateGpuTimings(std::vector<GpuPassTiming> const & timings);
+	void updateTimeline(int step, int stepCount);
 
 private:
+	// both hosts offer the same slots and signals
+	template<class Host>
+	void connectRenderHost(Host * host);
+	template<class Function>
+	void withRenderHost(Function const & function);
+
 	std::unique_ptr<Ui::GLMainWindow> ui;
+	// null for the widget host
+	RenderWindow * renderWindow;
 
 	std::map<QWidget *, bool> savedVisibilities;
 
 	void fillActionShortcuts(QWidget * base);
 	std::vector<QShortcut *> actionShortcuts;
+
+	QElapsedTimer gpuTimingsRefresh;
+
+	QToolBar * timelineToolBar;
+	QSlider * timelineSlider;
 };
@@ -0,0 +1,136 @@
+#include "GpuProfiler.hpp"
+
+#include <QOpenGLContext>
+
+#include <algorithm>
+
+// weight of the newest frame in the rolling average
+static constexpr double averageWeight = 0.05;
+
+GpuProfiler::Scope::Scope(GpuProfiler & profiler, char const * name)
+	: profiler{profiler}
+{
+	this->profiler.begin(name);
+}
+
+GpuProfiler::Scope::~Scope()
+{
+	this->profiler.end();
+}
+
+GpuProfiler::GpuProfiler()
+	: supported{false}
+	, current{0}
+{
+	// timer queries are core in 3.3 but implementations may still report zero counter bits
+	GLint bits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+	this->supported = bits > 0;
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	// the owner may be destroyed after its context is gone, the queries went with it
+	if(!QOpenGLContext::currentContext())
+		return;
+
+	for(auto & frame : this->frames)
+	{
+		if(!frame.queries.empty())
+			glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+	}
+}
+
+bool GpuProfiler::beginFrame()
+{
+	if(!this->supported)
+		return false;
+
+	this->current = (this->current + 1) % frameLatency;
+	auto & frame = this->frames[this->current];
+	auto updated = frame.pending && this->collect(frame);
+
+	frame.passes.clear();
+	frame.pending = false;
+	this->openPasses.clear();
+	this->begin("frame");
+	return updated;
+}
+
+void GpuProfiler::endFrame()
+{
+	if(!this->supported)
+		return;
+
+	while(!this->openPasses.empty())
+		this->end();
+	this->frames[this->current].pending = true;
+}
+
+void GpuProfiler::begin(char const * name)
+{
+	if(!this->supported)
+		return;
+
+	auto & frame = this->frames[this->current];
+	auto index = frame.passes.size();
+	frame.passes.push_back({name, static_cast<int>(this->openPasses.size())});
+	this->openPasses.push_back(index);
+	frame.lastQuery = 2 * index;
+	glQueryCounter(this->query(frame, frame.lastQuery), GL_TIMESTAMP);
+}
+
+void GpuProfiler::end()
+{
+	if(!this->supported || this->openPasses.empty())
+		return;
+
+	auto & frame = this->frames[this->current];
+	frame.lastQuery = 2 * this->openPasses.back() + 1;
+	glQueryCounter(this->query(frame, frame.lastQuery), GL_TIMESTAMP);
+	this->openPasses.pop_back();
+}
+
+std::vector<GpuPassTiming> const & GpuProfiler::timings() const
+{
+	return this->results;
+}
+
+bool GpuProfiler::collect(Frame & frame)
+{
+	// queries complete in the order they were issued, so the last one being available means all of them are and reading the results does not stall
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(frame.queries[frame.lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+	if(!available)
+		return false;
+
+	std::vector<GpuPassTiming> updated;
+	updated.reserve(frame.passes.size());
+	for(std::size_t i = 0; i < frame.passes.size(); ++i)
+	{
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+		auto milliseconds = 1e-6 * static_cast<double>(end - begin);
+
+		auto const & pass = frame.passes[i];
+		auto previous = std::find_if(this->results.begin(), this->results.end(), [&pass] (GpuPassTiming const & timing) {
+			return timing.name == pass.name;
+		});
+		auto average = previous == this->results.end() ? milliseconds : previous->averageMilliseconds + averageWeight * (milliseconds - previous->averageMilliseconds);
+		updated.push_back({pass.name, pass.depth, milliseconds, average});
+	}
+	this->results.swap(updated);
+	return true;
+}
+
+GLuint GpuProfiler::query(Frame & frame, std::size_t index)
+{
+	if(index >= frame.queries.size())
+	{
+		auto count = frame.queries.size();
+		frame.queries.resize(std::max<std::size_t>(2 * count, index + 1));
+		glGenQueries(static_cast<GLsizei>(frame.queries.size() - count), frame.queries.data() + count);
+	}
+	return frame.queries[index];
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "OpenGLRenderer.hpp"
+
+#include <array>
+#include <vector>
+
+// measures GPU time per render pass with GL_TIMESTAMP queries, results are read back frameLatency frames later so the CPU never waits for the GPU
+// passes may nest, frames whose queries are still not available by then are dropped; needs a current context during its whole lifetime
+class GpuProfiler
+{
+public:
+	class Scope
+	{
+	public:
+		Scope(GpuProfiler & profiler, char const * name);
+		~Scope();
+
+		Scope(Scope const &) = delete;
+		Scope & operator=(Scope const &) = delete;
+
+	private:
+		GpuProfiler & profiler;
+	};
+
+	GpuProfiler();
+	~GpuProfiler();
+
+	GpuProfiler(GpuProfiler const &) = delete;
+	GpuProfiler & operator=(GpuProfiler const &) = delete;
+
+	// returns true if the timings were updated from an older frame
+	bool beginFrame();
+	void endFrame();
+
+	// name has to outlive the profiler, usually a string literal
+	void begin(char const * name);
+	void end();
+
+	// one entry per pass in the order of the most recently collected frame, the first entry is the whole frame
+	std::vector<GpuPassTiming> const & timings() const;
+
+private:
+	static constexpr int frameLatency = 4;
+
+	struct Pass
+	{
+		char const * name;
+		int depth;
+	};
+
+	struct Frame
+	{
+		// pass i uses queries 2 * i and 2 * i + 1
+		std::vector<Pass> passes;
+		std::vector<GLuint> queries;
+		// the query issued last, normally the end of the frame scope (1) which endFrame closes after all others
+		std::size_t lastQuery = 0;
+		bool pending = false;
+	};
+
+	bool collect(Frame & frame);
+	GLuint query(Frame & frame, std::size_t index);
+
+	bool supported;
+	std::array<Frame, frameLatency> frames;
+	std::size_t current;
+	std::vector<std::size_t> openPasses;
+
+	std::vector<GpuPassTiming> results;
+};
@@ -0,0 +1,90 @@
+#include "Gravity.hpp"
+#include "BarnesHut.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+// measured crossover on a desktop CPU, below it the tree build costs more than it saves
+static constexpr Eigen::Index barnesHutThreshold = 2048;
+
+GravitySolver::GravitySolver(double gravitationalConstant, double softening)
+	: G{gravitationalConstant}
+	, epsilon{softening}
+{}
+
+double GravitySolver::gravitationalConstant() const
+{
+	return this->G;
+}
+
+double GravitySolver::softening() const
+{
+	return this->epsilon;
+}
+
+void AllPairsGravity::computeAccelerations(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & mass, Eigen::ArrayX3d & acceleration)
+{
+	auto n = position.rows();
+	auto epsilon2 = this->epsilon * this->epsilon;
+
+	acceleration.resize(n, 3);
+	this->weight.resize(n);
+
+	for(Eigen::Index i = 0; i < n; ++i)
+	{
+		Eigen::Array3d sum = Eigen::Array3d::Zero();
+		Eigen::Array3d p = position.row(i);
+
+		// the body itself is skipped by splitting the range instead of masking, so each segment stays a plain packet loop
+		auto accumulate = [&] (Eigen::Index start, Eigen::Index count) {
+			if(count <= 0)
+				return;
+
+			auto dx = position.col(0).segment(start, count) - p.x();
+			auto dy = position.col(1).segment(start, count) - p.y();
+			auto dz = position.col(2).segment(start, count) - p.z();
+			auto w = this->weight.segment(start, count);
+
+			w = dx.square() + dy.square() + dz.square() + epsilon2;
+			w = mass.segment(start, count) * w.rsqrt() / w;
+
+			sum.x() += (w * dx).sum();
+			sum.y() += (w * dy).sum();
+			sum.z() += (w * dz).sum();
+		};
+		accumulate(0, i);
+		accumulate(i + 1, n - i - 1);
+
+		acceleration.row(i) = this->G * sum;
+	}
+}
+
+std::unique_ptr<GravitySolver> createGravitySolver(Eigen::Index bodyCount, double gravitationalConstant, double softening)
+{
+	if(bodyCount < barnesHutThreshold)
+		return std::unique_ptr<GravitySolver>{new AllPairsGravity{gravitationalConstant, softening}};
+	return std::unique_ptr<GravitySolver>{new BarnesHutGravity{gravitationalConstant, softening}};
+}
+
+GravityComparison compareGravitySolvers(GravitySolver & reference, GravitySolver & candidate, Eigen::ArrayX3d const & position, Eigen::ArrayXd const & mass)
+{
+	using Clock = std::chrono::steady_clock;
+	GravityComparison result;
+	Eigen::ArrayX3d exact, approximate;
+
+	auto start = Clock::now();
+	reference.computeAccelerations(position, mass, exact);
+	auto middle = Clock::now();
+	candidate.computeAccelerations(position, mass, approximate);
+	auto end = Clock::now();
+
+	result.referenceSeconds = std::chrono::duration<double>(middle - start).count();
+	result.candidateSeconds = std::chrono::duration<double>(end - middle).count();
+
+	Eigen::ArrayXd error = (approximate - exact).matrix().rowwise().norm().array() / exact.matrix().rowwise().norm().array().max(std::numeric_limits<double>::min());
+	result.rmsRelativeError = error.size() ? std::sqrt(error.square().mean()) : 0;
+	result.maximumRelativeError = error.size() ? error.maxCoeff() : 0;
+	return result;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Eigen/Core>
+
+#include <memory>
+
+class GravitySolver
+{
+public:
+	GravitySolver(double gravitationalConstant = 1, double softening = 0);
+	virtual ~GravitySolver() = default;
+
+	double gravitationalConstant() const;
+	double softening() const;
+
+	// accelerations are laid out like the positions, one row per body
+	virtual void computeAccelerations(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & mass, Eigen::ArrayX3d & acceleration) = 0;
+
+protected:
+	double G, epsilon;
+};
+
+// exact O(N^2) summation, the inner loop runs over contiguous coordinate columns and is vectorized by Eigen
+class AllPairsGravity : public GravitySolver
+{
+public:
+	using GravitySolver::GravitySolver;
+
+	void computeAccelerations(Eigen::ArrayX3d const & position, Eigen::ArrayXd const & mass, Eigen::ArrayX3d & acceleration) override;
+
+private:
+	Eigen::ArrayXd weight;
+};
+
+// picks the exact solver for small systems and Barnes-Hut above the size where it starts to pay off
+std::unique_ptr<GravitySolver> createGravitySolver(Eigen::Index bodyCount, double gravitationalConstant = 1, double softening = 0);
+
+struct GravityComparison
+{
+	double referenceSeconds, candidateSeconds;
+	// per body |a - a_reference| / |a_reference|
+	double rmsRelativeError, maximumRelativeError;
+};
+
+GravityComparison compareGravitySolvers(GravitySolver & reference, GravitySolver & candidate, Eigen::ArrayX3d const & position, Eigen::ArrayXd const & mass);
@@ -0,0 +1,189 @@
+#include "Icosphere.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+
+static float icosahedronVertices[] = {
+	0.000000f, -1.000000f, 0.000000f,
+	0.723600f, -0.447214f, 0.525720f,
+	-0.276386f, -0.447214f, 0.850640f,
+	-0.894424f, -0.447214f, 0.000000f,
+	-0.276386f, -0.447214f, -0.850640f,
+	0.723600f, -0.447214f, -0.525720f,
+	0.276386f, 0.447214f, 0.850640f,
+	-0.723600f, 0.447214f, 0.525720f,
+	-0.723600f, 0.447214f, -0.525720f,
+	0.276386f, 0.447214f, -0.850640f,
+	0.894424f, 0.447214f, 0.000000f,
+	0.000000f, 1.000000f, 0.000000f
+};
+
+
+static unsigned char icosahedronIndices[] = {
+	0, 1, 2,
+	1, 0, 5,
+	0, 2, 3,
+	0, 3, 4,
+	0, 4, 5,
+	1, 5, 10,
+	2, 1, 6,
+	3, 2, 7,
+	4, 3, 8,
+	5, 4, 9,
+	1, 10, 6,
+	2, 6, 7,
+	3, 7, 8,
+	4, 8, 9,
+	5, 9, 10,
+	6, 10, 11,
+	7, 6, 11,
+	8, 7, 11,
+	9, 8, 11,
+	10, 9, 11
+};
+
+void createIcosahedron(std::vector<float> & vertices, std::vector<unsigned> & indices)
+{
+	vertices.assign(std::begin(icosahedronVertices), std::end(icosahedronVertices));
+	indices.assign(std::begin(icosahedronIndices), std::end(icosahedronIndices));
+}
+
+void subdivideIcosphere(std::vector<float> & vertices, std::vector<unsigned> & indices)
+{
+	// every edge of the closed mesh is shared by two triangles, so there are exactly indices.size() / 2 edges and as many new vertices
+	auto edgeCount = indices.size() / 2;
+	vertices.reserve(vertices.size() + 3 * edgeCount);
+
+	// every vertex of an icosphere has at most six neighbours, so each edge is stored in a fixed slot array of its lower vertex;
+	// the recursive triangle order keeps neighbouring slots close in memory, which beats a hash map keyed by the vertex pair
+	auto const maximumValence = 6;
+	auto const noNeighbour = ~0u;
+	auto vertexCount = vertices.size() / 3;
+	std::vector<unsigned> neighbours(maximumValence * vertexCount, noNeighbour);
+	std::vector<unsigned> midpoints(maximumValence * vertexCount);
+
+	auto midpointForEdge = [&] (unsigned first, unsigned second) {
+		if(first > second)
+			std::swap(first, second);
+		// the probe stays within the vertex's own slots, a full set means the mesh is no icosphere
+		auto slot = maximumValence * first;
+		auto lastSlot = slot + maximumValence;
+		for(; slot < lastSlot && neighbours[slot] != noNeighbour; ++slot)
+			if(neighbours[slot] == second)
+				return midpoints[slot];
+		assert(slot < lastSlot);
+
+		auto index = static_cast<unsigned>(vertices.size() / 3);
+		Eigen::Map<Eigen::Vector3f const> e0{vertices.data() + 3 * first};
+		Eigen::Map<Eigen::Vector3f const> e1{vertices.data() + 3 * second};
+		Eigen::Vector3f newVertex = (e0 + e1).normalized();
+		vertices.insert(std::end(vertices), newVertex.data(), newVertex.data() + 3);
+
+		// without a free slot the midpoint is not shared, which cracks the mesh instead of writing past the arrays
+		if(slot < lastSlot)
+		{
+			neighbours[slot] = second;
+			midpoints[slot] = index;
+		}
+		return index;
+	};
+
+	std::vector<unsigned> newIndices(4 * indices.size());
+	auto out = newIndices.data();
+	for(std::size_t i = 0; i < indices.size(); i += 3)
+	{
+		unsigned midpoints[3];
+		for(int e = 0; e < 3; ++e)
+			midpoints[e] = midpointForEdge(indices[i + e], indices[i + (e + 1) % 3]);
+		for(int e = 0; e < 3; ++e)
+		{
+			*out++ = indices[i + e];
+			*out++ = midpoints[e];
+			*out++ = midpoints[(e + 2) % 3];
+		}
+		out = std::copy(std::begin(midpoints), std::end(midpoints), out);
+	}
+	indices.swap(newIndices);
+}
+
+IcosphereMesh createIcosphereLevels(int maximumLevel)
+{
+	IcosphereMesh mesh;
+	std::vector<float> vertices;
+	std::vector<unsigned> indices;
+	createIcosahedron(vertices, indices);
+
+	// 20 * 4^level triangles per level and 10 * 4^level + 2 vertices in the finest one
+	std::size_t triangles = 0;
+	for(int level = 0; level <= maximumLevel; ++level)
+		triangles += std::size_t{20} << 2 * level;
+	std::vector<unsigned> levelIndices;
+	levelIndices.reserve(3 * triangles);
+	vertices.reserve(3 * ((std::size_t{10} << 2 * maximumLevel) + 2));
+
+	for(int level = 0; level <= maximumLevel; ++level)
+	{
+		if(level > 0)
+			subdivideIcosphere(vertices, indices);
+
+		// the triangle centers are closest to the origin
+		auto error = 0.;
+		for(std::size_t i = 0; i < indices.size(); i += 3)
+		{
+			Eigen::Vector3f center = Eigen::Vector3f::Zero();
+			for(int k = 0; k < 3; ++k)
+				center += Eigen::Map<Eigen::Vector3f const>{vertices.data() + 3 * indices[i + k]};
+			error = std::max(error, 1. - center.norm() / 3);
+		}
+
+		// the next level subdivides the optimized order, which keeps the new midpoints of neighbouring triangles close as well
+		auto vertexCount = vertices.size() / 3;
+		auto subdivided = averageCacheMissRatio(indices.data(), indices.size(), vertexCount);
+		optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+		auto optimized = averageCacheMissRatio(indices.data(), indices.size(), vertexCount);
+
+		mesh.levels.push_back({levelIndices.size(), indices.size(), error, subdivided, optimized});
+		levelIndices.insert(std::end(levelIndices), std::begin(indices), std::end(indices));
+	}
+
+	// levels are visited coarse to fine, so the vertices a level adds are numbered after the ones it shares with the coarser levels
+	auto vertexCount = vertices.size() / 3;
+	auto const unnumbered = ~0u;
+	std::vector<unsigned> numbers(vertexCount, unnumbered);
+	unsigned next = 0;
+	for(auto & index : levelIndices)
+	{
+		if(numbers[index] == unnumbered)
+			numbers[index] = next++;
+		index = numbers[index];
+	}
+
+	mesh.vertices.resize(2 * vertexCount);
+	for(std::size_t v = 0; v < vertexCount; ++v)
+		encodeOctahedral(vertices.data() + 3 * v, mesh.vertices.data() + 2 * numbers[v]);
+
+	mesh.indexSize = vertexCount <= 0x10000 ? sizeof(std::uint16_t) : sizeof(unsigned);
+	mesh.indices.resize(mesh.indexSize * levelIndices.size());
+	if(mesh.indexSize == sizeof(unsigned))
+		std::memcpy(mesh.indices.data(), levelIndices.data(), mesh.indices.size());
+	else
+	{
+		std::vector<std::uint16_t> narrowed(std::begin(levelIndices), std::end(levelIndices));
+		std::memcpy(mesh.indices.data(), narrowed.data(), mesh.indices.size());
+	}
+	return mesh;
+}
+
+int selectIcosphereLevel(std::vector<IcosphereLevel> const & levels, double projectedRadius, double maximumPixelError)
+{
+	auto count = static_cast<int>(levels.size());
+	for(int level = 0; level < count; ++level)
+		if(levels[level].geometricError * projectedRadius <= maximumPixelError)
+			return level;
+	return count - 1;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// the level 0 icosphere, 12 unit vertices and 20 triangles
+void createIcosahedron(std::vector<float> & vertices, std::vector<unsigned> & indices);
+
+// splits every triangle into four, new vertices are appended so the previous level's vertices keep their indices
+void subdivideIcosphere(std::vector<float> & vertices, std::vector<unsigned> & indices);
+
+struct IcosphereLevel
+{
+	std::size_t indexOffset, indexCount;
+	// largest distance between the flat triangles and the unit sphere
+	double geometricError;
+	// average cache miss ratio of the triangle order of the subdivision and of the optimized order
+	double subdividedCacheMissRatio, cacheMissRatio;
+};
+
+// all subdivision levels of a unit icosphere: the vertices of the finest level are shared by every level, each level uses a prefix of them,
+// and the index ranges of the levels are concatenated; triangles are ordered for the vertex cache and vertices by first use,
+// positions are octahedral encoded into two shorts per vertex (see encodeOctahedral) and indices take 16 bit when the vertex count allows
+struct IcosphereMesh
+{
+	std::vector<std::int16_t> vertices;
+	// indexSize bytes per index, 2 or 4
+	std::vector<unsigned char> indices;
+	std::size_t indexSize;
+	std::vector<IcosphereLevel> levels;
+};
+
+IcosphereMesh createIcosphereLevels(int maximumLevel);
+
+// coarsest level whose geometric error stays below maximumPixelError for a sphere covering projectedRadius pixels on screen
+int selectIcosphereLevel(std::vector<IcosphereLevel> const & levels, double projectedRadius, double maximumPixelError = 0.5);
@@ -0,0 +1,160 @@
+#include "IcosphereCache.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	// the file is only read back on the machine that wrote it, so native byte order and padding are fine
+	struct Header
+	{
+		char magic[8];
+		std::uint32_t version, maximumLevel;
+		std::uint64_t vertices, indices, indexSize;
+	};
+
+	struct StoredLevel
+	{
+		std::uint64_t indexOffset, indexCount;
+		double geometricError, subdividedCacheMissRatio, cacheMissRatio;
+	};
+}
+
+static char const cacheMagic[8] = {'I', 'C', 'O', 'S', 'P', 'H', 'R', 'E'};
+// bump whenever the generator output changes
+static constexpr std::uint32_t cacheVersion = 2;
+
+static QString cachePath(int maximumLevel)
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QString("/icosphere-%1.bin").arg(maximumLevel);
+}
+
+IcosphereCache::IcosphereCache(int maximumLevel)
+	: file{cachePath(maximumLevel)}
+	, vertexData{nullptr}
+	, vertexTotal{0}
+	, indexData{nullptr}
+	, indexTotal{0}
+	, indexBytes{0}
+{
+	if(this->map(maximumLevel))
+		return;
+
+	this->generated = createIcosphereLevels(maximumLevel);
+	write(this->file.fileName(), maximumLevel, this->generated);
+
+	// only reported when generating, the numbers cannot change until the cache version does
+	for(std::size_t level = 0; level < this->generated.levels.size(); ++level)
+	{
+		auto const & generatedLevel = this->generated.levels[level];
+		qDebug().nospace() << "icosphere level " << level << ": ACMR " << generatedLevel.subdividedCacheMissRatio << " subdivided, " << generatedLevel.cacheMissRatio << " optimized";
+	}
+
+	this->vertexData = this->generated.vertices.data();
+	this->vertexTotal = this->generated.vertices.size() / 2;
+	this->indexData = this->generated.indices.data();
+	this->indexBytes = this->generated.indexSize;
+	this->indexTotal = this->generated.indices.size() / this->indexBytes;
+	this->levelData = this->generated.levels;
+}
+
+std::int16_t const * IcosphereCache::vertices() const
+{
+	return this->vertexData;
+}
+
+std::size_t IcosphereCache::vertexCount() const
+{
+	return this->vertexTotal;
+}
+
+void const * IcosphereCache::indices() const
+{
+	return this->indexData;
+}
+
+std::size_t IcosphereCache::indexCount() const
+{
+	return this->indexTotal;
+}
+
+std::size_t IcosphereCache::indexSize() const
+{
+	return this->indexBytes;
+}
+
+std::vector<IcosphereLevel> const & IcosphereCache::levels() const
+{
+	return this->levelData;
+}
+
+bool IcosphereCache::map(int maximumLevel)
+{
+	if(!this->file.open(QIODevice::ReadOnly))
+		return false;
+
+	auto size = static_cast<std::uint64_t>(this->file.size());
+	auto data = size >= sizeof(Header) ? this->file.map(0, size) : nullptr;
+	if(!data)
+	{
+		this->file.close();
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	std::size_t levels = maximumLevel + 1;
+	auto expectedSize = sizeof(Header) + levels * sizeof(StoredLevel) + 2 * sizeof(std::int16_t) * header.vertices + header.indexSize * header.indices;
+	auto indexSizeValid = header.indexSize == sizeof(std::uint16_t) || header.indexSize == sizeof(unsigned);
+	if(std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion || header.maximumLevel != static_cast<std::uint32_t>(maximumLevel) || !indexSizeValid || size != expectedSize)
+	{
+		this->file.unmap(data);
+		this->file.close();
+		return false;
+	}
+
+	auto stored = reinterpret_cast<StoredLevel const *>(data + sizeof(Header));
+	for(std::size_t level = 0; level < levels; ++level)
+		this->levelData.push_back({static_cast<std::size_t>(stored[level].indexOffset), static_cast<std::size_t>(stored[level].indexCount), stored[level].geometricError, stored[level].subdividedCacheMissRatio, stored[level].cacheMissRatio});
+
+	this->vertexData = reinterpret_cast<std::int16_t const *>(stored + levels);
+	this->vertexTotal = static_cast<std::size_t>(header.vertices);
+	this->indexData = this->vertexData + 2 * this->vertexTotal;
+	this->indexTotal = static_cast<std::size_t>(header.indices);
+	this->indexBytes = static_cast<std::size_t>(header.indexSize);
+	return true;
+}
+
+void IcosphereCache::write(QString const & path, int maximumLevel, IcosphereMesh const & mesh)
+{
+	QDir{}.mkpath(QFileInfo{path}.absolutePath());
+
+	QSaveFile out{path};
+	if(!out.open(QIODevice::WriteOnly))
+		return;
+
+	Header header;
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.maximumLevel = maximumLevel;
+	header.vertices = mesh.vertices.size() / 2;
+	header.indices = mesh.indices.size() / mesh.indexSize;
+	header.indexSize = mesh.indexSize;
+	out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+
+	for(auto const & level : mesh.levels)
+	{
+		StoredLevel stored{level.indexOffset, level.indexCount, level.geometricError, level.subdividedCacheMissRatio, level.cacheMissRatio};
+		out.write(reinterpret_cast<char const *>(&stored), sizeof(stored));
+	}
+
+	out.write(reinterpret_cast<char const *>(mesh.vertices.data()), sizeof(std::int16_t) * mesh.vertices.size());
+	out.write(reinterpret_cast<char const *>(mesh.indices.data()), mesh.indices.size());
+	out.commit();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Icosphere.hpp"
+
+#include <QFile>
+
+// the icosphere levels are written to a binary file in the cache directory once and memory-mapped on later startups,
+// if the file cannot be written or mapped the mesh is generated in memory instead
+class IcosphereCache
+{
+public:
+	explicit IcosphereCache(int maximumLevel);
+
+	IcosphereCache(IcosphereCache const &) = delete;
+	IcosphereCache & operator=(IcosphereCache const &) = delete;
+
+	// two octahedral encoded shorts per vertex
+	std::int16_t const * vertices() const;
+	std::size_t vertexCount() const;
+
+	// indexSize() bytes per index
+	void const * indices() const;
+	std::size_t indexCount() const;
+	std::size_t indexSize() const;
+
+	std::vector<IcosphereLevel> const & levels() const;
+
+private:
+	bool map(int maximumLevel);
+	static void write(QString const & path, int maximumLevel, IcosphereMesh const & mesh);
+
+	QFile file;
+	IcosphereMesh generated;
+
+	std::int16_t const * vertexData;
+	std::size_t vertexTotal;
+	void const * indexData;
+	std::size_t indexTotal, indexBytes;
+	std::vector<IcosphereLevel> levelData;
+};
@@ -0,0 +1,202 @@
+#include "Integrators.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void SemiImplicitEulerIntegrator::step(BodyState & state, double dt, AccelerationFunction const & acceleration)
+{
+	acceleration(state.position, this->a);
+	state.velocity += dt * this->a;
+	state.position += dt * state.velocity;
+}
+
+void VelocityVerletIntegrator::step(BodyState & state, double dt, AccelerationFunction const & acceleration)
+{
+	if(!this->valid || this->a.rows() != state.size())
+		acceleration(state.position, this->a);
+
+	state.velocity += 0.5 * dt * this->a;
+	state.position += dt * state.velocity;
+	acceleration(state.position, this->a);
+	state.velocity += 0.5 * dt * this->a;
+	this->valid = true;
+}
+
+void VelocityVerletIntegrator::invalidate()
+{
+	this->valid = false;
+}
+
+void RungeKutta4Integrator::step(BodyState & state, double dt, AccelerationFunction const & acceleration)
+{
+	auto & x0 = state.position;
+	auto & v0 = state.velocity;
+
+	this->kx[0] = v0;
+	acceleration(x0, this->kv[0]);
+
+	static double const c[] = {0.5, 0.5, 1};
+	for(int s = 1; s < 4; ++s)
+	{
+		this->x = x0 + c[s - 1] * dt * this->kx[s - 1];
+		this->v = v0 + c[s - 1] * dt * this->kv[s - 1];
+		this->kx[s] = this->v;
+		acceleration(this->x, this->kv[s]);
+	}
+
+	x0 += dt / 6 * (this->kx[0] + 2 * this->kx[1] + 2 * this->kx[2] + this->kx[3]);
+	v0 += dt / 6 * (this->kv[0] + 2 * this->kv[1] + 2 * this->kv[2] + this->kv[3]);
+}
+
+void Yoshida4Integrator::step(BodyState & state, double dt, AccelerationFunction const & acceleration)
+{
+	static double const cubeRootOf2 = std::cbrt(2.);
+	static double const w1 = 1 / (2 - cubeRootOf2);
+	static double const w0 = -cubeRootOf2 * w1;
+	static double const c[] = {w1 / 2, (w0 + w1) / 2, (w0 + w1) / 2, w1 / 2};
+	static double const d[] = {w1, w0, w1};
+
+	for(int s = 0; s < 3; ++s)
+	{
+		state.position += c[s] * dt * state.velocity;
+		acceleration(state.position, this->a);
+		state.velocity += d[s] * dt * this->a;
+	}
+	state.position += c[3] * dt * state.velocity;
+}
+
+// Dormand & Prince (1980) tableau, the last row of A equals the fifth order weights
+static double const dormandPrinceA[7][6] = {
+	{},
+	{1. / 5},
+	{3. / 40, 9. / 40},
+	{44. / 45, -56. / 15, 32. / 9},
+	{19372. / 6561, -25360. / 2187, 64448. / 6561, -212. / 729},
+	{9017. / 3168, -355. / 33, 46732. / 5247, 49. / 176, -5103. / 18656},
+	{35. / 384, 0, 500. / 1113, 125. / 192, -2187. / 6784, 11. / 84}
+};
+
+// difference between the fifth and fourth order weights
+static double const dormandPrinceE[7] = {71. / 57600, 0, -71. / 16695, 71. / 1920, -17253. / 339200, 22. / 525, -1. / 40};
+
+DormandPrinceIntegrator::DormandPrinceIntegrator(double relativeTolerance, double absoluteTolerance)
+	: rtol{relativeTolerance}
+	, atol{absoluteTolerance}
+	, h{0}
+	, firstSameAsLast{false}
+	, rejected{0}
+	, accepted{0}
+{}
+
+void DormandPrinceIntegrator::step(BodyState & state, double dt, AccelerationFunction const & acceleration)
+{
+	auto n = state.size();
+	if(n == 0)
+		return;
+
+	auto & x0 = state.position;
+	auto & v0 = state.velocity;
+
+	if(this->kx[0].rows() != n)
+		this->firstSameAsLast = false;
+	if(this->h <= 0)
+		this->h = dt;
+
+	for(auto remaining = dt; remaining > 0;)
+	{
+		auto clipped = this->h >= remaining;
+		auto hs = clipped ? remaining : this->h;
+
+		if(!this->firstSameAsLast)
+		{
+			this->kx[0] = v0;
+			acceleration(x0, this->kv[0]);
+			this->firstSameAsLast = true;
+		}
+
+		for(int s = 1; s < 7; ++s)
+		{
+			this->x = x0;
+			this->v = v0;
+			for(int j = 0; j < s; ++j)
+			{
+				if(dormandPrinceA[s][j] == 0)
+					continue;
+				this->x += hs * dormandPrinceA[s][j] * this->kx[j];
+				this->v += hs * dormandPrinceA[s][j] * this->kv[j];
+			}
+			this->kx[s] = this->v;
+			acceleration(this->x, this->kv[s]);
+		}
+
+		this->errorX.setZero(n, 3);
+		this->errorV.setZero(n, 3);
+		for(int j = 0; j < 7; ++j)
+		{
+			if(dormandPrinceE[j] == 0)
+				continue;
+			this->errorX += hs * dormandPrinceE[j] * this->kx[j];
+			this->errorV += hs * dormandPrinceE[j] * this->kv[j];
+		}
+
+		auto scaledX = this->errorX / (this->atol + this->rtol * x0.abs().max(this->x.abs()));
+		auto scaledV = this->errorV / (this->atol + this->rtol * v0.abs().max(this->v.abs()));
+		auto error = std::sqrt((scaledX.square().sum() + scaledV.square().sum()) / (6 * n));
+
+		// steps below this size are accepted regardless so a singularity cannot stall the simulation thread
+		auto accept = error <= 1 || hs <= 1e-9 * dt;
+		if(accept)
+		{
+			x0.swap(this->x);
+			v0.swap(this->v);
+			std::swap(this->kx[0], this->kx[6]);
+			std::swap(this->kv[0], this->kv[6]);
+			remaining -= hs;
+			++this->accepted;
+		}
+		else
+			++this->rejected;
+
+		auto factor = error > 0 ? std::min(5., std::max(0.2, 0.9 * std::pow(error, -0.2))) : 5.;
+		// a step shortened to hit dt exactly says nothing about the step size the dynamics allow
+		if(accept && clipped)
+			this->h = std::max(this->h, hs * factor);
+		else
+			this->h = hs * factor;
+	}
+}
+
+void DormandPrinceIntegrator::invalidate()
+{
+	this->firstSameAsLast = false;
+}
+
+int DormandPrinceIntegrator::rejectedSteps() const
+{
+	return this->rejected;
+}
+
+int DormandPrinceIntegrator::acceptedSteps() const
+{
+	return this->accepted;
+}
+
+std::vector<std::string> integratorNames()
+{
+	return {"euler", "verlet", "rk4", "yoshida4", "dopri5"};
+}
+
+std::unique_ptr<Integrator> createIntegrator(std::string const & name)
+{
+	if(name == "euler")
+		return std::unique_ptr<Integrator>{new SemiImplicitEulerIntegrator};
+	if(name == "verlet")
+		return std::unique_ptr<Integrator>{new VelocityVerletIntegrator};
+	if(name == "rk4")
+		return std::unique_ptr<Integrator>{new RungeKutta4Integrator};
+	if(name == "yoshida4")
+		return std::unique_ptr<Integrator>{new Yoshida4Integrator};
+	if(name == "dopri5")
+		return std::unique_ptr<Integrator>{new DormandPrinceIntegrator};
+	return nullptr;
+}
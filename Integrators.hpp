@@ -0,0 +1,89 @@
+#pragma once
+
+#include "BodyState.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// integrators advance the whole batch of bodies at once, every stage is an expression over the contiguous N x 3 state arrays
+class Integrator
+{
+public:
+	using AccelerationFunction = std::function<void(Eigen::ArrayX3d const & position, Eigen::ArrayX3d & acceleration)>;
+
+	virtual ~Integrator() = default;
+
+	// advances position and velocity by exactly dt
+	virtual void step(BodyState & state, double dt, AccelerationFunction const & acceleration) = 0;
+
+	// must be called when the state was modified outside of step (e.g. by collision response) to drop cached accelerations
+	virtual void invalidate() {}
+};
+
+class SemiImplicitEulerIntegrator : public Integrator
+{
+public:
+	void step(BodyState & state, double dt, AccelerationFunction const & acceleration) override;
+
+private:
+	Eigen::ArrayX3d a;
+};
+
+// kick-drift-kick, reuses the acceleration of the previous step
+class VelocityVerletIntegrator : public Integrator
+{
+public:
+	void step(BodyState & state, double dt, AccelerationFunction const & acceleration) override;
+	void invalidate() override;
+
+private:
+	Eigen::ArrayX3d a;
+	bool valid = false;
+};
+
+class RungeKutta4Integrator : public Integrator
+{
+public:
+	void step(BodyState & state, double dt, AccelerationFunction const & acceleration) override;
+
+private:
+	Eigen::ArrayX3d x, v, kx[4], kv[4];
+};
+
+// fourth order symplectic composition of drift-kick steps (Yoshida 1990), three force evaluations per step
+class Yoshida4Integrator : public Integrator
+{
+public:
+	void step(BodyState & state, double dt, AccelerationFunction const & acceleration) override;
+
+private:
+	Eigen::ArrayX3d a;
+};
+
+// embedded Runge-Kutta 5(4) pair, subdivides dt as required by the error estimate and carries the step size over between calls
+class DormandPrinceIntegrator : public Integrator
+{
+public:
+	DormandPrinceIntegrator(double relativeTolerance = 1e-8, double absoluteTolerance = 1e-10);
+
+	void step(BodyState & state, double dt, AccelerationFunction const & acceleration) override;
+	void invalidate() override;
+
+	int rejectedSteps() const;
+	int acceptedSteps() const;
+
+private:
+	double rtol, atol;
+	double h;
+	bool firstSameAsLast;
+	int rejected, accepted;
+
+	Eigen::ArrayX3d x, v, errorX, errorV, kx[7], kv[7];
+};
+
+std::vector<std::string> integratorNames();
+
+// returns nullptr for unknown names
+std::unique_ptr<Integrator> createIntegrator(std::string const & name);
@@ -0,0 +1,215 @@
+#include "MeshOptimizer.hpp"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// size of the simulated LRU cache, larger than any hardware cache so the order degrades gracefully on all of them
+static constexpr int optimizerCacheSize = 32;
+
+// Forsyth's scoring: the three vertices of the last triangle score the same so none of them is preferred,
+// the others fall off with their position, and vertices with few remaining triangles get a boost so they are finished off instead of left as islands
+static float vertexScore(int cachePosition, unsigned remainingTriangles)
+{
+	if(remainingTriangles == 0)
+		return -1;
+
+	auto score = 0.f;
+	if(cachePosition >= 0)
+	{
+		if(cachePosition < 3)
+			score = 0.75f;
+		else
+			score = std::pow(1.f - static_cast<float>(cachePosition - 3) / (optimizerCacheSize - 3), 1.5f);
+	}
+	return score + 2.f / std::sqrt(static_cast<float>(remainingTriangles));
+}
+
+void optimizeVertexCache(unsigned * indices, std::size_t indexCount, std::size_t vertexCount)
+{
+	auto triangleCount = indexCount / 3;
+	if(triangleCount == 0)
+		return;
+
+	// triangles using each vertex, emitted triangles are swapped behind the remaining ones
+	std::vector<unsigned> remaining(vertexCount, 0);
+	for(std::size_t i = 0; i < 3 * triangleCount; ++i)
+		++remaining[indices[i]];
+	std::vector<std::size_t> firstTriangle(vertexCount + 1, 0);
+	for(std::size_t v = 0; v < vertexCount; ++v)
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+	std::vector<unsigned> vertexTriangles(firstTriangle.back());
+	{
+		auto cursor = firstTriangle;
+		for(std::size_t t = 0; t < triangleCount; ++t)
+			for(int k = 0; k < 3; ++k)
+				vertexTriangles[cursor[indices[3 * t + k]]++] = static_cast<unsigned>(t);
+	}
+
+	std::vector<float> scores(vertexCount);
+	for(std::size_t v = 0; v < vertexCount; ++v)
+		scores[v] = vertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<char> emitted(triangleCount, false);
+	auto scoreTriangle = [&] (std::size_t t) {
+		return scores[indices[3 * t]] + scores[indices[3 * t + 1]] + scores[indices[3 * t + 2]];
+	};
+	for(std::size_t t = 0; t < triangleCount; ++t)
+		triangleScores[t] = scoreTriangle(t);
+
+	std::vector<unsigned> ordered;
+	ordered.reserve(3 * triangleCount);
+
+	// room for the cache and the three vertices of the triangle pushed in front of it
+	std::vector<unsigned> cache, nextCache;
+	cache.reserve(optimizerCacheSize + 3);
+	nextCache.reserve(optimizerCacheSize + 3);
+
+	std::size_t best = 0;
+	for(std::size_t t = 1; t < triangleCount; ++t)
+		if(triangleScores[t] > triangleScores[best])
+			best = t;
+	// the full scan for a restart only has to look past the triangles emitted in order
+	std::size_t scanStart = 0;
+
+	for(std::size_t count = 0; count < triangleCount; ++count)
+	{
+		emitted[best] = true;
+		nextCache.clear();
+		for(int k = 0; k < 3; ++k)
+		{
+			auto v = indices[3 * best + k];
+			ordered.push_back(v);
+			nextCache.push_back(v);
+
+			// swap the triangle behind the vertex's remaining ones
+			auto first = firstTriangle[v], last = first + remaining[v];
+			for(auto i = first; i < last; ++i)
+			{
+				if(vertexTriangles[i] == best)
+				{
+					std::swap(vertexTriangles[i], vertexTriangles[last - 1]);
+					break;
+				}
+			}
+			--remaining[v];
+		}
+		for(auto v : cache)
+			if(v != nextCache[0] && v != nextCache[1] && v != nextCache[2])
+				nextCache.push_back(v);
+
+		// vertices pushed out of the cache lose their cache score
+		if(nextCache.size() > optimizerCacheSize)
+		{
+			for(std::size_t i = optimizerCacheSize; i < nextCache.size(); ++i)
+			{
+				auto v = nextCache[i];
+				scores[v] = vertexScore(-1, remaining[v]);
+				for(auto j = firstTriangle[v]; j < firstTriangle[v] + remaining[v]; ++j)
+					triangleScores[vertexTriangles[j]] = scoreTriangle(vertexTriangles[j]);
+			}
+			nextCache.resize(optimizerCacheSize);
+		}
+		cache.swap(nextCache);
+
+		// only triangles touching the cache changed, the best of them is the next one
+		for(std::size_t i = 0; i < cache.size(); ++i)
+			scores[cache[i]] = vertexScore(static_cast<int>(i), remaining[cache[i]]);
+		auto bestScore = -1.f;
+		auto found = false;
+		for(auto v : cache)
+		{
+			for(auto j = firstTriangle[v]; j < firstTriangle[v] + remaining[v]; ++j)
+			{
+				auto t = vertexTriangles[j];
+				triangleScores[t] = scoreTriangle(t);
+				if(triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					best = t;
+					found = true;
+				}
+			}
+		}
+		if(found || count + 1 == triangleCount)
+			continue;
+
+		// the cache has no triangles left, continue with the best remaining one anywhere
+		while(emitted[scanStart])
+			++scanStart;
+		best = scanStart;
+		for(auto t = scanStart; t < triangleCount; ++t)
+			if(!emitted[t] && triangleScores[t] > triangleScores[best])
+				best = t;
+	}
+
+	std::copy(ordered.begin(), ordered.end(), indices);
+}
+
+double averageCacheMissRatio(unsigned const * indices, std::size_t indexCount, std::size_t vertexCount, int cacheSize)
+{
+	auto triangleCount = indexCount / 3;
+	if(triangleCount == 0)
+		return 0;
+
+	// the time stamp of a vertex's insertion tells whether the FIFO still holds it
+	std::vector<std::size_t> insertedAt(vertexCount, 0);
+	std::size_t insertions = 0;
+	for(std::size_t i = 0; i < 3 * triangleCount; ++i)
+	{
+		auto & stamp = insertedAt[indices[i]];
+		if(stamp == 0 || insertions - stamp >= static_cast<std::size_t>(cacheSize))
+			stamp = ++insertions;
+	}
+	return static_cast<double>(insertions) / triangleCount;
+}
+
+void encodeOctahedral(float const * unitVector, std::int16_t * encoded)
+{
+	Eigen::Vector3f n{unitVector[0], unitVector[1], unitVector[2]};
+	Eigen::Vector2f p = n.head<2>() / n.cwiseAbs().sum();
+	if(n.z() < 0)
+	{
+		Eigen::Vector2f folded{(1 - std::abs(p.y())) * (p.x() >= 0 ? 1 : -1), (1 - std::abs(p.x())) * (p.y() >= 0 ? 1 : -1)};
+		p = folded;
+	}
+
+	// of the four neighbouring grid points the one decoding closest to n
+	auto bestSimilarity = -2.f;
+	for(int corner = 0; corner < 4; ++corner)
+	{
+		std::int16_t candidate[2];
+		for(int c = 0; c < 2; ++c)
+		{
+			auto scaled = p(c) * 32767;
+			auto rounded = (corner >> c & 1) ? std::ceil(scaled) : std::floor(scaled);
+			candidate[c] = static_cast<std::int16_t>(std::max(std::min(rounded, 32767.f), -32767.f));
+		}
+
+		Eigen::Vector3f decoded;
+		decodeOctahedral(candidate, decoded.data());
+		auto similarity = decoded.dot(n);
+		if(similarity > bestSimilarity)
+		{
+			bestSimilarity = similarity;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+void decodeOctahedral(std::int16_t const * encoded, float * unitVector)
+{
+	// the same as in body.vert
+	Eigen::Vector3f n{encoded[0] / 32767.f, encoded[1] / 32767.f, 0};
+	n.z() = 1 - std::abs(n.x()) - std::abs(n.y());
+	if(n.z() < 0)
+	{
+		Eigen::Vector2f folded{(1 - std::abs(n.y())) * (n.x() >= 0 ? 1 : -1), (1 - std::abs(n.x())) * (n.y() >= 0 ? 1 : -1)};
+		n.head<2>() = folded;
+	}
+	Eigen::Map<Eigen::Vector3f>{unitVector} = n.normalized();
+}
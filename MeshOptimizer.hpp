@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// reorders the triangles of an indexed triangle list for the post-transform vertex cache (Forsyth 2006, "Linear-Speed Vertex Cache Optimisation"),
+// greedily emitting the triangle whose vertices are most recently used in a simulated LRU cache or have the fewest triangles left
+void optimizeVertexCache(unsigned * indices, std::size_t indexCount, std::size_t vertexCount);
+
+// average cache miss ratio, transformed vertices per triangle with a FIFO cache of cacheSize vertices; 0.5 is the limit for large regular meshes, 3 means no reuse
+double averageCacheMissRatio(unsigned const * indices, std::size_t indexCount, std::size_t vertexCount, int cacheSize = 16);
+
+// maps a unit vector to the octahedron folded onto the square [-1, 1]^2 and quantizes it to 16 bit, picking the rounding with the smallest angular error
+// (Cigolle et al. 2014, "A Survey of Efficient Representations for Independent Unit Vectors")
+void encodeOctahedral(float const * unitVector, std::int16_t * encoded);
+void decodeOctahedral(std::int16_t const * encoded, float * unitVector);
@@ -1,9 +1,23 @@
 #pragma once
 
+#include <QMetaType>
 #include <QObject>
 
+#include <string>
+#include <vector>
+
 class QMouseEvent;
 
+struct GpuPassTiming
+{
+	std::string name;
+	// nesting level, 0 for the whole frame
+	int depth;
+	double lastMilliseconds, averageMilliseconds;
+};
+// for queued connections, see RenderWindow
+Q_DECLARE_METATYPE(std::vector<GpuPassTiming>)
+
 class OpenGLRenderer : public QObject
 {
 	Q_OBJECT
@@ -15,4 +29,22 @@ public:
 	virtual void render() = 0;
 
 	virtual void mouseEvent(QMouseEvent * e) = 0;
+
+	// true while resources are still streaming in, the benchmark waits for this to clear before measuring
+	virtual bool isLoading() const { return false; }
+	// seconds per simulation step since the last call, empty for renderers without a simulation
+	virtual std::vector<double> takeSimulationStepTimes() { return {}; }
+
+	virtual void setPaused(bool /*paused*/) {}
+
+	// jumps to a step of a recorded timeline, see timelineChanged
+	virtual void seekTimeline(int /*step*/) {}
+
+signals:
+	// something visible changed, may be emitted from any thread
+	void frameRequested();
+	// the displayed step of a recorded timeline moved, stepCount is 0 for renderers without a timeline
+	void timelineChanged(int step, int stepCount);
+	// emitted from render() whenever new GPU pass timings were read back
+	void gpuTimingsChanged(std::vector<GpuPassTiming> const & timings);
 };
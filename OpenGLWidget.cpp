@@ -1,5 +1,6 @@
 #include "OpenGLWidget.hpp"
 #include "OpenGLRenderer.hpp"
+#include "Profiler.hpp"
 
 #include <QDebug>
 #include <QEvent>
@@ -11,10 +12,14 @@
 OpenGLWidget::OpenGLWidget(QWidget * parent, Qt::WindowFlags f)
 	: QOpenGLWidget{parent, f}
 	, logger{nullptr}
+	, scheduler{new FrameScheduler{this}}
+	, renderer{nullptr}
 	, loggingEnabled{false}
 	, loggingSynchronous{false}
-	, renderer{nullptr}
-{}
+	, simulationPaused{false}
+{
+	this->connect(this->scheduler, &FrameScheduler::frameDue, this, static_cast<void (QWidget::*)()>(&QWidget::update));
+}
 
 void OpenGLWidget::setRendererFactory(std::function<OpenGLRenderer * (QObject * parent)> rendererFactory)
 {
@@ -29,11 +34,10 @@ void OpenGLWidget::setRendererFactory(std::function<OpenGLRenderer * (QObject *
 	if(this->rendererFactory)
 	{
 		this->renderer = this->rendererFactory(this);
-		if(this->renderer)
-			this->renderer->resize(this->width(), this->height());
+		this->attachRenderer();
 	}
 
-	this->update();
+	this->scheduler->requestFrame();
 	this->doneCurrent();
 }
 
@@ -51,6 +55,24 @@ bool OpenGLWidget::event(QEvent * e)
 	return QOpenGLWidget::event(e);
 }
 
+FrameScheduler * OpenGLWidget::frameScheduler() const
+{
+	return this->scheduler;
+}
+
+void OpenGLWidget::setSimulationPaused(bool paused)
+{
+	this->simulationPaused = paused;
+	if(this->renderer)
+		this->renderer->setPaused(paused);
+}
+
+void OpenGLWidget::seekTimeline(int step)
+{
+	if(this->renderer)
+		this->renderer->seekTimeline(step);
+}
+
 void OpenGLWidget::setLoggingEnabled(bool enable)
 {
 	if(enable == this->loggingEnabled)
@@ -113,15 +135,16 @@ void OpenGLWidget::initializeGL()
 		return;
 
 	this->renderer = this->rendererFactory(this);
-	if(this->renderer)
-		this->renderer->resize(this->width(), this->height());
+	this->attachRenderer();
 }
 
 void OpenGLWidget::paintGL()
 {
+	PROFILE_ZONE("paintGL");
+	this->scheduler->frameStarted();
 	if(this->renderer)
 		this->renderer->render();
-	update();
+	this->scheduler->frameFinished();
 }
 
 void OpenGLWidget::resizeGL(int w, int h)
@@ -129,3 +152,15 @@ void OpenGLWidget::resizeGL(int w, int h)
 	if(this->renderer)
 		this->renderer->resize(w, h);
 }
+
+void OpenGLWidget::attachRenderer()
+{
+	if(!this->renderer)
+		return;
+
+	this->connect(this->renderer, &OpenGLRenderer::gpuTimingsChanged, this, &OpenGLWidget::gpuTimingsChanged);
+	this->connect(this->renderer, &OpenGLRenderer::frameRequested, this->scheduler, &FrameScheduler::requestFrame);
+	this->connect(this->renderer, &OpenGLRenderer::timelineChanged, this, &OpenGLWidget::timelineChanged);
+	this->renderer->setPaused(this->simulationPaused);
+	this->renderer->resize(this->width(), this->height());
+}
@@ -2,12 +2,15 @@
 
 #include <glad/glad.h>
 
+#include "FrameScheduler.hpp"
+#include "OpenGLRenderer.hpp"
+
 #include <QOpenGLWidget>
 
 #include <functional>
+#include <vector>
 
 class QOpenGLDebugLogger;
-class OpenGLRenderer;
 
 class OpenGLWidget : public QOpenGLWidget
 {
@@ -20,13 +23,20 @@ public:
 
 	bool event(QEvent * e) override;
 
+	FrameScheduler * frameScheduler() const;
+
 public slots:
 	void setLoggingEnabled(bool enable);
 	void setLoggingSynchronous(bool synchronous);
+	void setSimulationPaused(bool paused);
+	void seekTimeline(int step);
 
 signals:
 	void loggingEnabledChanged(bool enable);
 	void loggingSynchronousChanged(bool synchronous);
+	// forwarded from the renderer
+	void gpuTimingsChanged(std::vector<GpuPassTiming> const & timings);
+	void timelineChanged(int step, int stepCount);
 
 protected:
 	void initializeGL() override;
@@ -34,10 +44,14 @@ protected:
 	void resizeGL(int w, int h) override;
 
 private:
+	// connects a freshly created renderer and brings it up to date with the widget
+	void attachRenderer();
+
 	QOpenGLDebugLogger * logger;
+	FrameScheduler * scheduler;
 
 	std::function<OpenGLRenderer * (QObject * parent)> rendererFactory;
 	OpenGLRenderer * renderer;
 
-	bool loggingEnabled, loggingSynchronous;
+	bool loggingEnabled, loggingSynchronous, simulationPaused;
 };
@@ -0,0 +1,12 @@
+#include "Parallel.hpp"
+#include "TaskScheduler.hpp"
+
+unsigned workerCount()
+{
+	return TaskScheduler::global().threadCount() + 1;
+}
+
+void parallelFor(std::ptrdiff_t begin, std::ptrdiff_t end, std::ptrdiff_t grain, std::function<void(std::ptrdiff_t, std::ptrdiff_t)> const & body)
+{
+	TaskScheduler::global().parallelFor(begin, end, grain, body);
+}
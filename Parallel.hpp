@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// threads of TaskScheduler::global() plus the calling thread
+unsigned workerCount();
+
+// splits [begin, end) into chunks of at least grain elements and runs body(chunkBegin, chunkEnd) on all cores, returns when all chunks are done
+void parallelFor(std::ptrdiff_t begin, std::ptrdiff_t end, std::ptrdiff_t grain, std::function<void(std::ptrdiff_t, std::ptrdiff_t)> const & body);
@@ -0,0 +1,171 @@
+#include "ParticleSystem.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+// longest step of the particle integration, shorter than a body step since the belt is integrated with a first order scheme
+static constexpr double maximumTimeStep = 1. / 240;
+// a larger gap (after a pause in rendering or a replay seek) is skipped instead of integrated
+static constexpr int maximumStepsPerAdvance = 16;
+
+// radii of the belt around the center of mass, outside the orbit of the moon
+static constexpr double beltInnerRadius = 2, beltOuterRadius = 3.2;
+static constexpr double beltThickness = 0.03;
+
+// floats per particle: position and velocity, interleaved in the order of the transform feedback varyings
+static constexpr int particleFloats = 6;
+
+// particles on nearly circular orbits around the center of mass of bodies, in the plane the bodies orbit in (z = 0)
+static std::vector<GLfloat> createBelt(std::size_t count, BodyState const & bodies, std::uint32_t seed)
+{
+	auto totalMass = bodies.mass.sum();
+	Eigen::RowVector3d center = Eigen::RowVector3d::Zero(), drift = Eigen::RowVector3d::Zero();
+	if(totalMass > 0)
+	{
+		center = (bodies.position.colwise() * bodies.mass).colwise().sum().matrix() / totalMass;
+		drift = (bodies.velocity.colwise() * bodies.mass).colwise().sum().matrix() / totalMass;
+	}
+
+	std::mt19937 generator{seed};
+	std::uniform_real_distribution<double> uniform;
+	std::normal_distribution<double> normal;
+
+	std::vector<GLfloat> state(particleFloats * count);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		// uniform in area
+		auto r = std::sqrt(beltInnerRadius * beltInnerRadius + uniform(generator) * (beltOuterRadius * beltOuterRadius - beltInnerRadius * beltInnerRadius));
+		auto angle = 2 * 3.14159265358979323846 * uniform(generator);
+		auto speed = std::sqrt(totalMass / r) * (1 + 0.02 * normal(generator));
+
+		Eigen::RowVector3d position = center + Eigen::RowVector3d{r * std::cos(angle), r * std::sin(angle), beltThickness * normal(generator)};
+		Eigen::RowVector3d velocity = drift + speed * Eigen::RowVector3d{-std::sin(angle), std::cos(angle), 0};
+
+		auto particle = state.data() + particleFloats * i;
+		for(int c = 0; c < 3; ++c)
+		{
+			particle[c] = static_cast<GLfloat>(position(c));
+			particle[3 + c] = static_cast<GLfloat>(velocity(c));
+		}
+	}
+	return state;
+}
+
+ParticleSystem::ParticleSystem(ShaderManager & shaders, std::size_t count, BodyState const & bodies, std::uint32_t seed)
+	: count{count}
+	, time{bodies.time}
+	, initialTime{bodies.time}
+	, initialState{createBelt(count, bodies, seed)}
+	, current{0}
+{
+	PROFILE_ZONE("ParticleSystem::ParticleSystem");
+
+	for(int i = 0; i < 2; ++i)
+	{
+		this->buffers[i].create();
+		this->buffers[i].setUsagePattern(QOpenGLBuffer::DynamicCopy);
+		this->buffers[i].bind();
+		this->buffers[i].allocate(static_cast<int>(sizeof(GLfloat) * this->initialState.size()));
+
+		this->vertexArrays[i].create();
+		QOpenGLVertexArrayObject::Binder boundVAO{&this->vertexArrays[i]};
+
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * particleFloats, nullptr);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * particleFloats, reinterpret_cast<void *>(sizeof(GLfloat) * 3));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	this->reset();
+
+	this->stepProgram = &shaders.program({":/shaders/particleStep.vert"}, {"outPosition", "outVelocity"});
+	this->renderProgram = &shaders.program({":/shaders/particle.frag", ":/shaders/particle.vert"});
+}
+
+std::size_t ParticleSystem::size() const
+{
+	return this->count;
+}
+
+void ParticleSystem::reset()
+{
+	this->buffers[0].bind();
+	this->buffers[0].write(0, this->initialState.data(), static_cast<int>(sizeof(GLfloat) * this->initialState.size()));
+	this->buffers[0].release();
+	this->current = 0;
+	this->time = this->initialTime;
+}
+
+void ParticleSystem::advance(BodyState const & bodies)
+{
+	PROFILE_ZONE("ParticleSystem::advance");
+
+	if(bodies.time < this->time)
+		this->reset();
+
+	auto elapsed = bodies.time - this->time;
+	if(elapsed <= 0 || this->count == 0)
+		return;
+
+	auto steps = std::min(static_cast<int>(std::ceil(elapsed / maximumTimeStep)), maximumStepsPerAdvance);
+	auto dt = std::min(elapsed / steps, maximumTimeStep);
+	this->time = bodies.time;
+
+	// the heaviest bodies, the others barely move a particle
+	std::vector<Eigen::Index> order(bodies.size());
+	std::iota(order.begin(), order.end(), Eigen::Index{0});
+	auto attractorCount = std::min<std::size_t>(order.size(), maximumAttractors);
+	std::partial_sort(order.begin(), order.begin() + attractorCount, order.end(), [&] (Eigen::Index a, Eigen::Index b) {
+		return bodies.mass(a) > bodies.mass(b);
+	});
+
+	GLfloat attractors[4 * maximumAttractors];
+	for(std::size_t a = 0; a < attractorCount; ++a)
+	{
+		for(int c = 0; c < 3; ++c)
+			attractors[4 * a + c] = static_cast<GLfloat>(bodies.position(order[a], c));
+		attractors[4 * a + 3] = static_cast<GLfloat>(bodies.mass(order[a]));
+	}
+
+	auto pid = this->stepProgram->id();
+	glUseProgram(pid);
+	glUniform4fv(glGetUniformLocation(pid, "attractors"), static_cast<GLsizei>(attractorCount), attractors);
+	glUniform1i(glGetUniformLocation(pid, "attractorCount"), static_cast<GLint>(attractorCount));
+	glUniform1f(glGetUniformLocation(pid, "timeStep"), static_cast<GLfloat>(dt));
+
+	glEnable(GL_RASTERIZER_DISCARD);
+	for(int step = 0; step < steps; ++step)
+	{
+		auto next = 1 - this->current;
+		QOpenGLVertexArrayObject::Binder boundVAO{&this->vertexArrays[this->current]};
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, this->buffers[next].bufferId());
+
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(this->count));
+		glEndTransformFeedback();
+
+		this->current = next;
+	}
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glDisable(GL_RASTERIZER_DISCARD);
+}
+
+void ParticleSystem::render(Eigen::Matrix4f const & viewProjection, float pixelScale)
+{
+	if(this->count == 0)
+		return;
+
+	QOpenGLVertexArrayObject::Binder boundVAO{&this->vertexArrays[this->current]};
+
+	auto pid = this->renderProgram->id();
+	glUseProgram(pid);
+	glUniformMatrix4fv(glGetUniformLocation(pid, "viewProjection"), 1, GL_FALSE, viewProjection.data());
+	glUniform1f(glGetUniformLocation(pid, "pixelScale"), pixelScale);
+
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(this->count));
+	glDisable(GL_PROGRAM_POINT_SIZE);
+}
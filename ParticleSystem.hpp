@@ -0,0 +1,53 @@
+#pragma once
+
+#include "BodyState.hpp"
+#include "ShaderManager.hpp"
+
+#include <glad/glad.h>
+
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+
+#include <Eigen/Core>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// massless particles (an asteroid belt around the center of mass of the bodies) that are attracted by the heaviest bodies but do not attract anything themselves
+// the state lives in two buffers on the GPU, every step reads one and writes the other through transform feedback; needs a current context during its whole lifetime
+class ParticleSystem
+{
+public:
+	// at most this many bodies attract particles, lighter ones are ignored
+	static constexpr int maximumAttractors = 16;
+
+	ParticleSystem(ShaderManager & shaders, std::size_t count, BodyState const & bodies, std::uint32_t seed = 42);
+
+	ParticleSystem(ParticleSystem const &) = delete;
+	ParticleSystem & operator=(ParticleSystem const &) = delete;
+
+	std::size_t size() const;
+
+	// integrates the particles from the time of the last call to bodies.time, going back in time (a replay seek) starts over from the initial belt
+	void advance(BodyState const & bodies);
+	// round point sprites of a fixed world space size, pixelScale is the height in pixels of a unit length at unit distance
+	void render(Eigen::Matrix4f const & viewProjection, float pixelScale);
+
+private:
+	void reset();
+
+	std::size_t count;
+	double time, initialTime;
+	// the belt is generated once, resetting re-uploads it
+	std::vector<GLfloat> initialState;
+
+	// buffer current holds the latest state, the vertex array of the same index reads it
+	std::array<QOpenGLBuffer, 2> buffers;
+	std::array<QOpenGLVertexArrayObject, 2> vertexArrays;
+	int current;
+
+	// owned by the manager, uniform locations are looked up on use since reloading may move them
+	ShaderManager::Program const * stepProgram, * renderProgram;
+};
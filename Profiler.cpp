@@ -0,0 +1,242 @@
+#include "Profiler.hpp"
+
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Event
+	{
+		char const * name;
+		std::int64_t timestamp;
+		// nanoseconds for zones
+		std::int64_t duration;
+		double value;
+		bool counter;
+	};
+
+	// written by the owning thread only, count is published after the event so readers never see a partial one
+	struct Chunk
+	{
+		static constexpr std::size_t capacity = 4096;
+
+		std::array<Event, capacity> events;
+		std::atomic<std::size_t> count{0};
+		std::atomic<Chunk *> next{nullptr};
+	};
+
+	struct ThreadBuffer
+	{
+		int id;
+		// guarded by the registry mutex
+		std::string name;
+
+		std::atomic<Chunk *> head{nullptr};
+		// owned by the thread
+		Chunk * tail = nullptr;
+		// the capture the events belong to
+		unsigned capture = 0;
+
+		~ThreadBuffer()
+		{
+			for(auto chunk = this->head.load(); chunk;)
+			{
+				auto next = chunk->next.load();
+				delete chunk;
+				chunk = next;
+			}
+		}
+
+		// keeps the first chunk for the next capture and frees the others, needs the registry mutex as the trace writer may be reading them
+		void recycle()
+		{
+			auto first = this->head.load();
+			if(!first)
+				return;
+
+			for(auto chunk = first->next.load(); chunk;)
+			{
+				auto next = chunk->next.load();
+				delete chunk;
+				chunk = next;
+			}
+			first->next.store(nullptr);
+			first->count.store(0);
+			this->tail = first;
+		}
+
+		void append(Event const & event)
+		{
+			if(!this->tail || this->tail->count.load(std::memory_order_relaxed) == Chunk::capacity)
+			{
+				auto chunk = new Chunk;
+				if(this->tail)
+					this->tail->next.store(chunk, std::memory_order_release);
+				else
+					this->head.store(chunk, std::memory_order_release);
+				this->tail = chunk;
+			}
+
+			auto count = this->tail->count.load(std::memory_order_relaxed);
+			this->tail->events[count] = event;
+			this->tail->count.store(count + 1, std::memory_order_release);
+		}
+	};
+
+	// buffers outlive their threads so events of finished workers still make it into the trace
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> threads;
+		std::atomic<std::int64_t> captureStart{0};
+		// counts the captures started, a thread drops its old events on its first event of a new capture
+		std::atomic<unsigned> capture{0};
+	};
+}
+
+std::atomic<bool> Profiler::enabled{false};
+
+static Registry & registry()
+{
+	static Registry instance;
+	return instance;
+}
+
+static ThreadBuffer & threadBuffer()
+{
+	thread_local ThreadBuffer * buffer = nullptr;
+	if(!buffer)
+	{
+		auto & threads = registry();
+		std::lock_guard<std::mutex> lock{threads.mutex};
+		threads.threads.emplace_back(new ThreadBuffer);
+		buffer = threads.threads.back().get();
+		buffer->id = static_cast<int>(threads.threads.size());
+	}
+	return *buffer;
+}
+
+static void record(Event const & event)
+{
+	auto & buffer = threadBuffer();
+	auto & threads = registry();
+	auto capture = threads.capture.load(std::memory_order_relaxed);
+	if(buffer.capture != capture)
+	{
+		// once per thread and capture, so memory stays bounded by the longest capture instead of growing with every one
+		std::lock_guard<std::mutex> lock{threads.mutex};
+		buffer.recycle();
+		buffer.capture = capture;
+	}
+	buffer.append(event);
+}
+
+static void writeEscaped(QTextStream & out, char const * text)
+{
+	out << '"';
+	for(; *text; ++text)
+	{
+		if(*text == '"' || *text == '\\')
+			out << '\\';
+		out << *text;
+	}
+	out << '"';
+}
+
+void Profiler::setEnabled(bool enable)
+{
+	if(enable && !enabled.load(std::memory_order_relaxed))
+	{
+		registry().captureStart.store(now(), std::memory_order_relaxed);
+		++registry().capture;
+	}
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(char const * name)
+{
+	auto & buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock{registry().mutex};
+	buffer.name = name;
+}
+
+std::int64_t Profiler::now()
+{
+	static auto const epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::recordZone(char const * name, std::int64_t begin, std::int64_t end)
+{
+	record({name, begin, end - begin, 0, false});
+}
+
+void Profiler::recordCounter(char const * name, double value)
+{
+	record({name, now(), 0, value, true});
+}
+
+bool Profiler::writeChromeTrace(QString const & path)
+{
+	QSaveFile file{path};
+	if(!file.open(QIODevice::WriteOnly))
+		return false;
+
+	QTextStream out{&file};
+	out.setRealNumberNotation(QTextStream::FixedNotation);
+	out.setRealNumberPrecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	auto & threads = registry();
+	auto captureStart = threads.captureStart.load(std::memory_order_relaxed);
+	auto first = true;
+	auto separator = [&] {
+		if(!first)
+			out << ",\n";
+		first = false;
+	};
+
+	std::lock_guard<std::mutex> lock{threads.mutex};
+	for(auto const & thread : threads.threads)
+	{
+		if(!thread->name.empty())
+		{
+			separator();
+			out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id << ",\"args\":{\"name\":";
+			writeEscaped(out, thread->name.c_str());
+			out << "}}";
+		}
+
+		for(auto chunk = thread->head.load(std::memory_order_acquire); chunk; chunk = chunk->next.load(std::memory_order_acquire))
+		{
+			auto count = chunk->count.load(std::memory_order_acquire);
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				auto const & event = chunk->events[i];
+				if(event.timestamp < captureStart)
+					continue;
+
+				// timestamps and durations are in microseconds
+				separator();
+				out << "{\"name\":";
+				writeEscaped(out, event.name);
+				out << ",\"pid\":1,\"tid\":" << thread->id << ",\"ts\":" << 1e-3 * event.timestamp;
+				if(event.counter)
+					out << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}";
+				else
+					out << ",\"ph\":\"X\",\"dur\":" << 1e-3 * event.duration << '}';
+			}
+		}
+	}
+
+	out << "\n]}\n";
+	out.flush();
+	return file.commit();
+}
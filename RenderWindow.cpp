@@ -0,0 +1,381 @@
+#include <glad/glad.h>
+
+#include "RenderWindow.hpp"
+#include "Profiler.hpp"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QMouseEvent>
+#include <QOpenGLContext>
+#include <QOpenGLDebugLogger>
+#include <QTimer>
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+#include <QPlatformSurfaceEvent>
+#endif
+
+static std::uint64_t packSize(int w, int h)
+{
+	return static_cast<std::uint64_t>(static_cast<std::uint32_t>(w)) << 32 | static_cast<std::uint32_t>(h);
+}
+
+static int packedWidth(std::uint64_t size)
+{
+	return static_cast<int>(size >> 32);
+}
+
+static int packedHeight(std::uint64_t size)
+{
+	return static_cast<int>(size & 0xffffffffu);
+}
+
+RenderWorker::RenderWorker(RenderWindow * window)
+	: window{window}
+	, context{new QOpenGLContext{this}}
+	, logger{nullptr}
+	, scheduler{new FrameScheduler{this}}
+	, renderer{nullptr}
+	, initialized{false}
+	, loggingEnabled{false}
+	, loggingSynchronous{false}
+	, simulationPaused{false}
+	, renderedSize{0}
+{
+	// created on the GUI thread and moved along with the worker
+	this->context->setFormat(window->requestedFormat());
+	if(!this->context->create())
+		qWarning() << "Could not create an OpenGL context for the render thread";
+
+	// queued like QWidget::update, so a continuous scheduler does not recurse from frameFinished into the next frame
+	this->connect(this->scheduler, &FrameScheduler::frameDue, this, &RenderWorker::render, Qt::QueuedConnection);
+}
+
+RenderWorker::~RenderWorker() = default;
+
+void RenderWorker::setRendererFactory(std::function<OpenGLRenderer * (QObject * parent)> rendererFactory)
+{
+	this->rendererFactory = std::move(rendererFactory);
+	// otherwise the first frame creates the renderer
+	if(!this->initialized || !this->context->makeCurrent(this->window))
+		return;
+
+	delete this->renderer;
+	this->renderer = nullptr;
+	this->createRenderer();
+
+	this->scheduler->requestFrame();
+}
+
+void RenderWorker::setLogging(bool enable, bool synchronous)
+{
+	this->loggingEnabled = enable;
+	this->loggingSynchronous = synchronous;
+
+	if(!this->logger || !this->context->makeCurrent(this->window))
+		return;
+
+	this->logger->stopLogging();
+	if(enable)
+		this->logger->startLogging(synchronous ? QOpenGLDebugLogger::SynchronousLogging : QOpenGLDebugLogger::AsynchronousLogging);
+}
+
+void RenderWorker::setSimulationPaused(bool paused)
+{
+	this->simulationPaused = paused;
+	if(this->renderer)
+		this->renderer->setPaused(paused);
+}
+
+void RenderWorker::seekTimeline(int step)
+{
+	if(this->renderer)
+		this->renderer->seekTimeline(step);
+}
+
+FrameScheduler * RenderWorker::frameScheduler() const
+{
+	return this->scheduler;
+}
+
+void RenderWorker::processInput()
+{
+	// cleared first, an event pushed while draining posts another call at worst
+	this->window->inputPending = false;
+
+	QueuedMouseEvent queued;
+	while(this->window->mouseEvents.pop(queued))
+	{
+		if(!this->renderer)
+			continue;
+
+		QMouseEvent e{queued.type, queued.localPos, queued.windowPos, queued.screenPos, queued.button, queued.buttons, queued.modifiers};
+		this->renderer->mouseEvent(&e);
+	}
+}
+
+void RenderWorker::render()
+{
+	// a frame that is due stays due until the next expose event draws
+	if(!this->window->exposed || !this->context->isValid() || !this->context->makeCurrent(this->window))
+		return;
+
+	PROFILE_ZONE("render thread frame");
+
+	if(!this->initialized)
+	{
+		this->initialized = true;
+
+		this->logger = new QOpenGLDebugLogger{this};
+		connect(this->logger, &QOpenGLDebugLogger::messageLogged, [] (QOpenGLDebugMessage const & debugMessage) {
+			qDebug() << debugMessage;
+		});
+		this->logger->initialize();
+		this->logger->disableMessages(QOpenGLDebugMessage::AnySource, QOpenGLDebugMessage::AnyType, QOpenGLDebugMessage::NotificationSeverity);
+		if(this->loggingEnabled)
+			this->logger->startLogging(this->loggingSynchronous ? QOpenGLDebugLogger::SynchronousLogging : QOpenGLDebugLogger::AsynchronousLogging);
+
+		// see OpenGLWidget::initializeGL
+		thread_local QOpenGLContext * gl_context = nullptr;
+		gl_context = this->context;
+		gladLoadGLLoader([] (char const * name) { return reinterpret_cast<void *>(gl_context->getProcAddress(name)); });
+
+		this->createRenderer();
+	}
+
+	this->processInput();
+
+	auto size = this->window->packedSize.load();
+	if(this->renderer && size != this->renderedSize)
+	{
+		this->renderer->resize(packedWidth(size), packedHeight(size));
+		this->renderedSize = size;
+	}
+	// QOpenGLWidget sets the viewport before paintGL, the window's framebuffer is in device pixels
+	auto framebufferSize = this->window->packedFramebufferSize.load();
+	glViewport(0, 0, packedWidth(framebufferSize), packedHeight(framebufferSize));
+
+	this->scheduler->frameStarted();
+	if(this->renderer)
+		this->renderer->render();
+	// blocks for vsync here rather than on the GUI thread
+	this->context->swapBuffers(this->window);
+	this->scheduler->frameFinished();
+}
+
+void RenderWorker::shutdown()
+{
+	// the renderer owns GL objects, destroy it while the context is still current
+	auto current = this->initialized && this->context->makeCurrent(this->window);
+	if(this->initialized && !current)
+		qWarning() << "Could not make the render thread's context current, GL objects are leaked";
+	delete this->renderer;
+	this->renderer = nullptr;
+	delete this->logger;
+	this->logger = nullptr;
+	if(current)
+		this->context->doneCurrent();
+
+	delete this->scheduler;
+	this->scheduler = nullptr;
+	delete this->context;
+	this->context = nullptr;
+
+	this->moveToThread(QCoreApplication::instance()->thread());
+}
+
+void RenderWorker::createRenderer()
+{
+	if(!this->rendererFactory)
+		return;
+
+	this->renderer = this->rendererFactory(this);
+	if(!this->renderer)
+		return;
+
+	// the window's signals are emitted on the GUI thread, the connections are queued
+	this->connect(this->renderer, &OpenGLRenderer::gpuTimingsChanged, this->window, &RenderWindow::gpuTimingsChanged);
+	this->connect(this->renderer, &OpenGLRenderer::frameRequested, this->scheduler, &FrameScheduler::requestFrame);
+	this->connect(this->renderer, &OpenGLRenderer::timelineChanged, this->window, &RenderWindow::timelineChanged);
+	this->renderer->setPaused(this->simulationPaused);
+	this->renderedSize = this->window->packedSize;
+	this->renderer->resize(packedWidth(this->renderedSize), packedHeight(this->renderedSize));
+}
+
+RenderWindow::RenderWindow(QWindow * parent)
+	: QWindow{parent}
+	, exposed{false}
+	, packedSize{0}
+	, packedFramebufferSize{0}
+	, inputPending{false}
+	, loggingEnabled{false}
+	, loggingSynchronous{false}
+{
+	qRegisterMetaType<std::vector<GpuPassTiming>>();
+
+	this->setSurfaceType(QWindow::OpenGLSurface);
+
+	this->worker.reset(new RenderWorker{this});
+	this->mode = this->worker->frameScheduler()->mode();
+	this->cap = this->worker->frameScheduler()->frameRateCap();
+
+	this->connect(&this->thread, &QThread::started, [] { Profiler::setThreadName("render"); });
+	this->worker->moveToThread(&this->thread);
+	this->thread.start();
+}
+
+RenderWindow::~RenderWindow()
+{
+	// normally done already when the surface was destroyed
+	this->stopRendering();
+}
+
+void RenderWindow::stopRendering()
+{
+	if(!this->thread.isRunning())
+		return;
+
+	// waits for a frame in progress, then destroys the renderer with the context current on the still existing surface
+	this->exposed = false;
+	QMetaObject::invokeMethod(this->worker.get(), "shutdown", Qt::BlockingQueuedConnection);
+	this->thread.quit();
+	this->thread.wait();
+}
+
+template<class Function>
+void RenderWindow::post(Function function)
+{
+	// the worker is back on the GUI thread without a context once the render thread ended
+	if(!this->thread.isRunning())
+		return;
+	QTimer::singleShot(0, this->worker.get(), std::move(function));
+}
+
+void RenderWindow::setRendererFactory(std::function<OpenGLRenderer * (QObject * parent)> rendererFactory)
+{
+	auto worker = this->worker.get();
+	this->post([worker, rendererFactory] { worker->setRendererFactory(rendererFactory); });
+}
+
+FrameScheduler::Mode RenderWindow::frameMode() const
+{
+	return this->mode;
+}
+
+void RenderWindow::setFrameMode(FrameScheduler::Mode mode)
+{
+	this->mode = mode;
+	auto worker = this->worker.get();
+	this->post([worker, mode] { worker->frameScheduler()->setMode(mode); });
+}
+
+double RenderWindow::frameRateCap() const
+{
+	return this->cap;
+}
+
+void RenderWindow::setFrameRateCap(double framesPerSecond)
+{
+	this->cap = framesPerSecond;
+	auto worker = this->worker.get();
+	this->post([worker, framesPerSecond] { worker->frameScheduler()->setFrameRateCap(framesPerSecond); });
+}
+
+void RenderWindow::setLoggingEnabled(bool enable)
+{
+	if(enable == this->loggingEnabled)
+		return;
+
+	this->loggingEnabled = enable;
+	emit this->loggingEnabledChanged(enable);
+
+	auto worker = this->worker.get();
+	auto synchronous = this->loggingSynchronous;
+	this->post([worker, enable, synchronous] { worker->setLogging(enable, synchronous); });
+}
+
+void RenderWindow::setLoggingSynchronous(bool synchronous)
+{
+	if(synchronous == this->loggingSynchronous)
+		return;
+
+	this->loggingSynchronous = synchronous;
+	emit this->loggingSynchronousChanged(synchronous);
+
+	auto worker = this->worker.get();
+	auto enable = this->loggingEnabled;
+	this->post([worker, enable, synchronous] { worker->setLogging(enable, synchronous); });
+}
+
+void RenderWindow::setSimulationPaused(bool paused)
+{
+	auto worker = this->worker.get();
+	this->post([worker, paused] { worker->setSimulationPaused(paused); });
+}
+
+void RenderWindow::seekTimeline(int step)
+{
+	auto worker = this->worker.get();
+	this->post([worker, step] { worker->seekTimeline(step); });
+}
+
+bool RenderWindow::event(QEvent * e)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+	// QWidget::createWindowContainer destroys the surface before it deletes the window, the destructor would be too late
+	if(e->type() == QEvent::PlatformSurface && static_cast<QPlatformSurfaceEvent *>(e)->surfaceEventType() == QPlatformSurfaceEvent::SurfaceAboutToBeDestroyed)
+		this->stopRendering();
+#endif
+	return QWindow::event(e);
+}
+
+void RenderWindow::exposeEvent(QExposeEvent *)
+{
+	this->exposed = this->isExposed();
+	if(this->exposed)
+		this->renderNow();
+}
+
+void RenderWindow::resizeEvent(QResizeEvent *)
+{
+	this->packedSize = packSize(this->width(), this->height());
+	auto ratio = this->devicePixelRatio();
+	this->packedFramebufferSize = packSize(static_cast<int>(this->width() * ratio), static_cast<int>(this->height() * ratio));
+	if(this->exposed)
+		this->renderNow();
+}
+
+void RenderWindow::mousePressEvent(QMouseEvent * e)
+{
+	this->queueMouseEvent(e);
+}
+
+void RenderWindow::mouseReleaseEvent(QMouseEvent * e)
+{
+	this->queueMouseEvent(e);
+}
+
+void RenderWindow::mouseMoveEvent(QMouseEvent * e)
+{
+	this->queueMouseEvent(e);
+}
+
+void RenderWindow::queueMouseEvent(QMouseEvent * e)
+{
+	e->accept();
+	// only full if the render thread hangs, losing events is the lesser evil then
+	if(!this->mouseEvents.push({e->type(), e->button(), e->buttons(), e->modifiers(), e->localPos(), e->windowPos(), e->screenPos()}))
+		return;
+
+	if(this->inputPending.exchange(true))
+		return;
+
+	auto worker = this->worker.get();
+	this->post([worker] { worker->processInput(); });
+}
+
+void RenderWindow::renderNow()
+{
+	// like a widget repaint on expose, outside of the frame scheduler
+	auto worker = this->worker.get();
+	this->post([worker] { worker->render(); });
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "FrameScheduler.hpp"
+#include "OpenGLRenderer.hpp"
+#include "SpscQueue.hpp"
+
+#include <QEvent>
+#include <QPointF>
+#include <QThread>
+#include <QWindow>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class QOpenGLContext;
+class QOpenGLDebugLogger;
+class RenderWindow;
+
+// what the renderer needs of a mouse event, copied on the GUI thread as the event itself does not outlive its handler
+struct QueuedMouseEvent
+{
+	QEvent::Type type;
+	Qt::MouseButton button;
+	Qt::MouseButtons buttons;
+	Qt::KeyboardModifiers modifiers;
+	QPointF localPos, windowPos, screenPos;
+};
+
+// lives on the render thread and owns everything used there: the context, the frame scheduler and the renderer
+class RenderWorker : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit RenderWorker(RenderWindow * window);
+	~RenderWorker();
+
+	// all of these have to be called on the render thread
+	void setRendererFactory(std::function<OpenGLRenderer * (QObject * parent)> rendererFactory);
+	void setLogging(bool enable, bool synchronous);
+	void setSimulationPaused(bool paused);
+	void seekTimeline(int step);
+	FrameScheduler * frameScheduler() const;
+
+	// hands queued mouse events to the renderer
+	void processInput();
+	// draws a frame if the window is exposed, the scheduler calls this and expose and resize events do as well
+	void render();
+
+	// destroys the GL resources while the window's surface still exists and moves back to the GUI thread
+	Q_INVOKABLE void shutdown();
+
+private:
+	void createRenderer();
+
+	RenderWindow * window;
+	QOpenGLContext * context;
+	QOpenGLDebugLogger * logger;
+	FrameScheduler * scheduler;
+
+	std::function<OpenGLRenderer * (QObject * parent)> rendererFactory;
+	OpenGLRenderer * renderer;
+
+	bool initialized, loggingEnabled, loggingSynchronous, simulationPaused;
+	std::uint64_t renderedSize;
+};
+
+// an alternative to OpenGLWidget that keeps rendering off the GUI thread: a render thread with its own context and frame scheduler draws into this window
+// and blocks in swapBuffers instead of the event loop, so busy widgets do not delay frames and slow frames do not stall the interface
+// embed it with QWidget::createWindowContainer; needs QOpenGLContext::supportsThreadedOpenGL()
+// rendering ends for good once the native surface is destroyed, so the container must not be reparented to another top level window
+class RenderWindow : public QWindow
+{
+	Q_OBJECT
+
+public:
+	explicit RenderWindow(QWindow * parent = nullptr);
+	~RenderWindow();
+
+	void setRendererFactory(std::function<OpenGLRenderer * (QObject * parent)> rendererFactory);
+
+	// the scheduler lives on the render thread, these forward to it
+	FrameScheduler::Mode frameMode() const;
+	void setFrameMode(FrameScheduler::Mode mode);
+	double frameRateCap() const;
+	void setFrameRateCap(double framesPerSecond);
+
+public slots:
+	void setLoggingEnabled(bool enable);
+	void setLoggingSynchronous(bool synchronous);
+	void setSimulationPaused(bool paused);
+	void seekTimeline(int step);
+
+signals:
+	void loggingEnabledChanged(bool enable);
+	void loggingSynchronousChanged(bool synchronous);
+	// forwarded from the renderer
+	void gpuTimingsChanged(std::vector<GpuPassTiming> const & timings);
+	void timelineChanged(int step, int stepCount);
+
+protected:
+	bool event(QEvent * e) override;
+	void exposeEvent(QExposeEvent *) override;
+	void resizeEvent(QResizeEvent *) override;
+	void mousePressEvent(QMouseEvent * e) override;
+	void mouseReleaseEvent(QMouseEvent * e) override;
+	void mouseMoveEvent(QMouseEvent * e) override;
+
+private:
+	friend class RenderWorker;
+
+	// runs function on the render thread
+	template<class Function>
+	void post(Function function);
+	void queueMouseEvent(QMouseEvent * e);
+	void renderNow();
+	// shuts the worker down and ends the render thread, does nothing the second time
+	void stopRendering();
+
+	QThread thread;
+	std::unique_ptr<RenderWorker> worker;
+
+	// written on the GUI thread, read by the render thread
+	std::atomic<bool> exposed;
+	// width in the high and height in the low half, so both change at once
+	std::atomic<std::uint64_t> packedSize;
+	// the same in device pixels, for the viewport
+	std::atomic<std::uint64_t> packedFramebufferSize;
+	SpscQueue<QueuedMouseEvent, 256> mouseEvents;
+	// set while a processInput call is on its way, so a burst of events posts only one
+	std::atomic<bool> inputPending;
+
+	// mirrors of the render thread's state for the GUI thread
+	FrameScheduler::Mode mode;
+	double cap;
+	bool loggingEnabled, loggingSynchronous;
+};
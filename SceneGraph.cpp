@@ -0,0 +1,112 @@
+#include "SceneGraph.hpp"
+
+#include <cmath>
+
+constexpr SceneGraph::Node SceneGraph::root;
+
+Frustum::Frustum()
+	: planeCount{0}
+{}
+
+Frustum::Frustum(Eigen::Matrix4d const & viewProjection)
+	: planeCount{0}
+{
+	// left, right, bottom, top, near, far: w +- x, w +- y, w +- z
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		for(double sign : {1., -1.})
+		{
+			Eigen::Vector4d plane = (viewProjection.row(3) + sign * viewProjection.row(axis)).transpose();
+			auto length = plane.head<3>().norm();
+			if(length > 1e-12)
+				this->planes[this->planeCount++] = plane / length;
+		}
+	}
+}
+
+bool Frustum::intersects(BoundingSphere const & sphere) const
+{
+	for(int p = 0; p < this->planeCount; ++p)
+	{
+		auto const & plane = this->planes[p];
+		if(plane.head<3>().dot(sphere.center) + plane(3) < -sphere.radius)
+			return false;
+	}
+	return true;
+}
+
+SceneGraph::SceneGraph()
+{
+	this->parents.push_back(root);
+	this->local.push_back(Eigen::Affine3d::Identity());
+	this->world.push_back(Eigen::Affine3d::Identity());
+	this->boundingRadius.push_back(0);
+	this->bounds.push_back({Eigen::Vector3d::Zero(), 0});
+	this->dirty.push_back(true);
+	this->updated.push_back(false);
+}
+
+SceneGraph::Node SceneGraph::addNode(Node parent, Eigen::Affine3d const & local, double boundingRadius)
+{
+	auto node = static_cast<Node>(this->parents.size());
+	this->parents.push_back(parent);
+	this->local.push_back(local);
+	this->world.push_back(Eigen::Affine3d::Identity());
+	this->boundingRadius.push_back(boundingRadius);
+	this->bounds.push_back({Eigen::Vector3d::Zero(), 0});
+	this->dirty.push_back(true);
+	this->updated.push_back(false);
+	return node;
+}
+
+std::size_t SceneGraph::size() const
+{
+	return this->parents.size();
+}
+
+void SceneGraph::setLocalTransform(Node node, Eigen::Affine3d const & local)
+{
+	this->local[node] = local;
+	this->dirty[node] = true;
+}
+
+Eigen::Affine3d const & SceneGraph::localTransform(Node node) const
+{
+	return this->local[node];
+}
+
+void SceneGraph::update()
+{
+	for(Node node = 0; node < this->parents.size(); ++node)
+	{
+		auto parent = this->parents[node];
+		// the root is its own parent, its flag is only set by the root itself
+		auto inherited = node != root && this->updated[parent];
+		this->updated[node] = this->dirty[node] || inherited;
+		if(!this->updated[node])
+			continue;
+
+		this->world[node] = node == root ? this->local[node] : this->world[parent] * this->local[node];
+		this->dirty[node] = false;
+
+		// the largest axis scale bounds how far a non-uniform scaling can stretch the sphere
+		auto const & w = this->world[node];
+		this->bounds[node].center = w.translation();
+		this->bounds[node].radius = this->boundingRadius[node] * w.linear().colwise().norm().maxCoeff();
+	}
+}
+
+Eigen::Affine3d const & SceneGraph::worldTransform(Node node) const
+{
+	return this->world[node];
+}
+
+BoundingSphere const & SceneGraph::worldBounds(Node node) const
+{
+	return this->bounds[node];
+}
+
+bool SceneGraph::wasUpdated(Node node) const
+{
+	return this->updated[node];
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct BoundingSphere
+{
+	Eigen::Vector3d center;
+	double radius;
+};
+
+// the clip planes of a view projection matrix in world space (Gribb and Hartmann 2001)
+class Frustum
+{
+public:
+	// contains everything
+	Frustum();
+	explicit Frustum(Eigen::Matrix4d const & viewProjection);
+
+	// conservative, spheres near a corner may pass although they are outside
+	bool intersects(BoundingSphere const & sphere) const;
+
+private:
+	// (normal, offset) with normalized normals, inside is normal . p + offset >= 0; planes with a zero normal are dropped
+	std::array<Eigen::Vector4d, 6> planes;
+	int planeCount;
+};
+
+// a hierarchy of transforms where every node caches its world transform and bounding sphere, only nodes whose own or an ancestor's local transform changed are recomputed
+// nodes are stored in creation order and parents have to exist before their children, so one pass in index order updates the whole tree
+class SceneGraph
+{
+public:
+	using Node = std::uint32_t;
+	static constexpr Node root = 0;
+
+	SceneGraph();
+
+	// boundingRadius is in the node's local space, nodes without extent use 0
+	Node addNode(Node parent, Eigen::Affine3d const & local = Eigen::Affine3d::Identity(), double boundingRadius = 0);
+	std::size_t size() const;
+
+	// may be called concurrently for different nodes
+	void setLocalTransform(Node node, Eigen::Affine3d const & local);
+	Eigen::Affine3d const & localTransform(Node node) const;
+
+	// recomputes what changed since the last call
+	void update();
+
+	// as of the last update
+	Eigen::Affine3d const & worldTransform(Node node) const;
+	BoundingSphere const & worldBounds(Node node) const;
+	// whether the last update recomputed the node
+	bool wasUpdated(Node node) const;
+
+private:
+	std::vector<Node> parents;
+	std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>> local, world;
+	std::vector<double> boundingRadius;
+	std::vector<BoundingSphere> bounds;
+	// chars rather than bools, so different nodes can be flagged from different threads
+	std::vector<char> dirty, updated;
+};
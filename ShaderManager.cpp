@@ -0,0 +1,252 @@
+#include "ShaderManager.hpp"
+#include "Profiler.hpp"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	struct Header
+	{
+		char magic[8];
+		std::uint32_t version, format;
+	};
+}
+
+static char const cacheMagic[8] = {'G', 'L', 'P', 'R', 'O', 'G', 'R', 'M'};
+static constexpr std::uint32_t cacheVersion = 1;
+
+static QString cachePath(QByteArray const & key)
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders/" + QString::fromLatin1(key.toHex()) + ".bin";
+}
+
+static QOpenGLShader::ShaderType shaderType(QString const & source)
+{
+	if(source.endsWith(".frag"))
+		return QOpenGLShader::Fragment;
+	if(source.endsWith(".geom"))
+		return QOpenGLShader::Geometry;
+	return QOpenGLShader::Vertex;
+}
+
+static bool readBinary(QString const & path, GLuint program)
+{
+	QFile file{path};
+	if(!file.open(QIODevice::ReadOnly))
+		return false;
+
+	auto contents = file.readAll();
+	if(static_cast<std::size_t>(contents.size()) <= sizeof(Header))
+		return false;
+
+	Header header;
+	std::memcpy(&header, contents.constData(), sizeof(header));
+	if(std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion)
+		return false;
+
+	// drivers reject binaries of other versions even if the renderer string did not change, the caller falls back to the sources then
+	glProgramBinary(program, header.format, contents.constData() + sizeof(Header), static_cast<GLsizei>(contents.size() - sizeof(Header)));
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	return linked == GL_TRUE;
+}
+
+static void writeBinary(QString const & path, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0)
+		return;
+
+	QByteArray binary(length, Qt::Uninitialized);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	binary.resize(length);
+
+	QDir{}.mkpath(QFileInfo{path}.absolutePath());
+
+	QSaveFile out{path};
+	if(!out.open(QIODevice::WriteOnly))
+		return;
+
+	Header header;
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.format = format;
+	out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+	out.write(binary);
+	out.commit();
+}
+
+GLuint ShaderManager::Program::id() const
+{
+	return this->program ? this->program->programId() : 0;
+}
+
+ShaderManager::ShaderManager(QObject * parent)
+	: QObject{parent}
+	, binariesSupported{false}
+{
+	GLint formats = 0;
+	if(GLAD_GL_ARB_get_program_binary)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	this->binariesSupported = formats > 0;
+
+	// binaries are only valid for the driver that produced them
+	for(auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+	{
+		this->driver += reinterpret_cast<char const *>(glGetString(name));
+		this->driver += '\n';
+	}
+
+	connect(&this->watcher, &QFileSystemWatcher::fileChanged, this, [this] (QString const & path) {
+		this->changedFiles.insert(path);
+		// editors often replace the file instead of writing it, which ends the watch
+		if(!this->watcher.files().contains(path) && QFileInfo::exists(path))
+			this->watcher.addPath(path);
+		emit this->sourcesChanged();
+	});
+}
+
+ShaderManager::Program const & ShaderManager::program(std::vector<QString> const & sources, std::vector<QByteArray> const & feedbackVaryings)
+{
+	QString key;
+	for(auto const & source : sources)
+		key += source + '\n';
+	for(auto const & varying : feedbackVaryings)
+		key += QString::fromLatin1(varying) + ' ';
+
+	auto & program = this->programs[key];
+	if(program)
+		return *program;
+
+	program.reset(new Program);
+	program->sources = sources;
+	program->varyings = feedbackVaryings;
+	program->program = this->link(*program);
+	for(auto const & source : sources)
+		this->watch(source);
+	return *program;
+}
+
+void ShaderManager::setSourceDirectory(QString const & directory)
+{
+	this->sourceDirectory = directory;
+	for(auto const & program : this->programs)
+		for(auto const & source : program.second->sources)
+			this->watch(source);
+}
+
+bool ShaderManager::reloadChanged()
+{
+	if(this->changedFiles.isEmpty())
+		return false;
+
+	PROFILE_ZONE("reload shaders");
+
+	auto replaced = false;
+	for(auto & entry : this->programs)
+	{
+		auto & program = *entry.second;
+		auto changed = false;
+		for(auto const & source : program.sources)
+			changed = changed || this->changedFiles.contains(this->sourcePath(source));
+		if(!changed)
+			continue;
+
+		auto linked = this->link(program);
+		if(!linked)
+			continue;
+
+		program.program = std::move(linked);
+		replaced = true;
+	}
+	this->changedFiles.clear();
+	return replaced;
+}
+
+QString ShaderManager::sourcePath(QString const & source) const
+{
+	if(this->sourceDirectory.isEmpty())
+		return source;
+
+	auto path = QDir{this->sourceDirectory}.filePath(QFileInfo{source}.fileName());
+	return QFileInfo::exists(path) ? path : source;
+}
+
+void ShaderManager::watch(QString const & source)
+{
+	auto path = this->sourcePath(source);
+	if(path != source && !this->watcher.files().contains(path))
+		this->watcher.addPath(path);
+}
+
+std::unique_ptr<QOpenGLShaderProgram> ShaderManager::link(Program const & program) const
+{
+	PROFILE_ZONE("link shader program");
+
+	QCryptographicHash hash{QCryptographicHash::Sha1};
+	hash.addData(this->driver);
+
+	std::vector<QByteArray> code;
+	for(auto const & source : program.sources)
+	{
+		QFile file{this->sourcePath(source)};
+		if(!file.open(QIODevice::ReadOnly))
+		{
+			qWarning() << "Could not read the shader" << file.fileName();
+			return nullptr;
+		}
+		code.push_back(file.readAll());
+
+		hash.addData(source.toUtf8());
+		hash.addData("\0", 1);
+		hash.addData(code.back());
+		hash.addData("\0", 1);
+	}
+	for(auto const & varying : program.varyings)
+	{
+		hash.addData(varying);
+		hash.addData("\0", 1);
+	}
+	auto path = cachePath(hash.result());
+
+	std::unique_ptr<QOpenGLShaderProgram> linked{new QOpenGLShaderProgram};
+	linked->create();
+	auto id = linked->programId();
+
+	// without attached shaders link() only picks up the state of the loaded binary
+	if(this->binariesSupported && readBinary(path, id) && linked->link())
+		return linked;
+
+	for(std::size_t s = 0; s < program.sources.size(); ++s)
+		if(!linked->addShaderFromSourceCode(shaderType(program.sources[s]), code[s]))
+			return nullptr;
+
+	if(!program.varyings.empty())
+	{
+		std::vector<char const *> names;
+		for(auto const & varying : program.varyings)
+			names.push_back(varying.constData());
+		glTransformFeedbackVaryings(id, static_cast<GLsizei>(names.size()), names.data(), GL_INTERLEAVED_ATTRIBS);
+	}
+
+	if(this->binariesSupported)
+		glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	if(!linked->link())
+		return nullptr;
+
+	if(this->binariesSupported)
+		writeBinary(path, id);
+	return linked;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QOpenGLShaderProgram>
+#include <QSet>
+#include <QString>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+// links every distinct combination of shader sources once and keeps the linked binaries in the cache directory (GL_ARB_get_program_binary),
+// keyed by a hash of the sources and the driver, so later starts skip compilation; needs a current context during its whole lifetime
+class ShaderManager : public QObject
+{
+	Q_OBJECT
+
+public:
+	class Program
+	{
+	public:
+		// 0 if the program never linked
+		GLuint id() const;
+
+	private:
+		friend class ShaderManager;
+
+		std::vector<QString> sources;
+		std::vector<QByteArray> varyings;
+		std::unique_ptr<QOpenGLShaderProgram> program;
+	};
+
+	explicit ShaderManager(QObject * parent = nullptr);
+
+	// sources are resource paths like ":/shaders/body.vert", the stage follows from the extension; varyings are captured by transform feedback
+	// requesting the same sources again returns the same program, which lives as long as the manager
+	Program const & program(std::vector<QString> const & sources, std::vector<QByteArray> const & feedbackVaryings = {});
+
+	// sources are read from directory instead of the resources where it has a file of the same name, changes to those files are picked up by reloadChanged()
+	void setSourceDirectory(QString const & directory);
+
+	// relinks programs whose sources changed on disk, a program that fails to link keeps its previous version
+	// returns true if any program was replaced, uniform locations of the replaced programs have to be queried again
+	bool reloadChanged();
+
+signals:
+	// a watched source file changed, the next reloadChanged() will relink its programs
+	void sourcesChanged();
+
+private:
+	QString sourcePath(QString const & source) const;
+	void watch(QString const & source);
+	std::unique_ptr<QOpenGLShaderProgram> link(Program const & program) const;
+
+	bool binariesSupported;
+	QByteArray driver;
+
+	std::map<QString, std::unique_ptr<Program>> programs;
+
+	QString sourceDirectory;
+	QFileSystemWatcher watcher;
+	QSet<QString> changedFiles;
+};
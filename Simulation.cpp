@@ -0,0 +1,205 @@
+#include "Simulation.hpp"
+#include "Collisions.hpp"
+#include "Gravity.hpp"
+#include "Integrators.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+// upper bound on steps taken to catch up with the wall clock before the backlog is dropped
+static constexpr int maximumCatchUpSteps = 8;
+// step times nobody collects are dropped beyond this many, about nine minutes at 120 Hz
+static constexpr std::size_t maximumStepTimes = 1 << 16;
+
+Simulation::Simulation(BodyState initialState, StepFunction step, double timeStep)
+	: step{std::move(step)}
+	, dt{timeStep}
+	, state{std::move(initialState)}
+	, back{2}
+	, ready{1}
+	, front{0}
+	, running{false}
+	, paused{false}
+{
+	auto now = Clock::now();
+	for(auto & snapshot : this->snapshots)
+		snapshot = {this->state, now};
+	this->previous = {this->state, now};
+}
+
+Simulation::~Simulation()
+{
+	this->stop();
+}
+
+void Simulation::setPublishCallback(std::function<void()> callback)
+{
+	this->publishCallback = std::move(callback);
+}
+
+void Simulation::setStepCallback(std::function<void(BodyState const & state)> callback)
+{
+	this->stepCallback = std::move(callback);
+}
+
+void Simulation::start()
+{
+	if(this->running.exchange(true))
+		return;
+
+	this->worker = std::thread{&Simulation::run, this};
+}
+
+void Simulation::stop()
+{
+	if(!this->running.exchange(false))
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock{this->pauseMutex};
+		this->pauseCondition.notify_all();
+	}
+	this->worker.join();
+}
+
+void Simulation::setPaused(bool paused)
+{
+	std::lock_guard<std::mutex> lock{this->pauseMutex};
+	this->paused = paused;
+	this->pauseCondition.notify_all();
+}
+
+bool Simulation::isPaused() const
+{
+	return this->paused;
+}
+
+double Simulation::timeStep() const
+{
+	return this->dt;
+}
+
+std::vector<double> Simulation::takeStepTimes()
+{
+	std::vector<double> times;
+	std::lock_guard<std::mutex> lock{this->stepTimesMutex};
+	times.swap(this->stepTimes);
+	return times;
+}
+
+void Simulation::interpolatedState(BodyState & state)
+{
+	this->acquire();
+
+	auto const & current = this->snapshots[this->front];
+
+	// render one step behind the latest state so there is always a pair to interpolate between
+	auto elapsed = std::chrono::duration<double>(Clock::now() - current.published).count();
+	auto renderTime = current.state.time - this->dt + std::min(elapsed, this->dt);
+	auto span = current.state.time - this->previous.state.time;
+
+	if(span <= 0 || this->previous.state.size() != current.state.size())
+	{
+		state = current.state;
+		return;
+	}
+
+	auto alpha = std::max(0., std::min((renderTime - this->previous.state.time) / span, 1.));
+
+	state = current.state;
+	state.position = this->previous.state.position + alpha * (current.state.position - this->previous.state.position);
+	state.time = this->previous.state.time + alpha * span;
+}
+
+void Simulation::run()
+{
+	Profiler::setThreadName("simulation");
+
+	auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(this->dt));
+	auto next = Clock::now() + period;
+
+	while(this->running)
+	{
+		if(this->paused)
+		{
+			std::unique_lock<std::mutex> lock{this->pauseMutex};
+			this->pauseCondition.wait(lock, [this] { return !this->paused || !this->running; });
+			next = Clock::now() + period;
+			continue;
+		}
+
+		auto now = Clock::now();
+		if(now < next)
+		{
+			std::this_thread::sleep_until(next);
+			continue;
+		}
+
+		double times[maximumCatchUpSteps];
+		auto steps = 0;
+		for(; next <= now && steps < maximumCatchUpSteps; ++steps)
+		{
+			PROFILE_ZONE("simulation step");
+			auto begin = Clock::now();
+			this->step(this->state, this->dt);
+			times[steps] = std::chrono::duration<double>(Clock::now() - begin).count();
+			this->state.time += this->dt;
+			next += period;
+			if(this->stepCallback)
+				this->stepCallback(this->state);
+		}
+		{
+			std::lock_guard<std::mutex> lock{this->stepTimesMutex};
+			if(this->stepTimes.size() + steps > maximumStepTimes)
+				this->stepTimes.erase(this->stepTimes.begin(), this->stepTimes.begin() + maximumStepTimes / 2);
+			this->stepTimes.insert(this->stepTimes.end(), times, times + steps);
+		}
+		// a step is slower than real time, drop the backlog instead of spiralling
+		if(next <= now)
+			next = now + period;
+
+		PROFILE_COUNTER("catch-up steps", steps);
+		this->publish();
+		if(this->publishCallback)
+			this->publishCallback();
+	}
+}
+
+void Simulation::publish()
+{
+	auto & snapshot = this->snapshots[this->back];
+	snapshot.state = this->state;
+	snapshot.published = Clock::now();
+	this->back = this->ready.exchange(this->back | freshBit, std::memory_order_acq_rel) & ~freshBit;
+}
+
+void Simulation::acquire()
+{
+	if(!(this->ready.load(std::memory_order_relaxed) & freshBit))
+		return;
+
+	// the old front becomes the interpolation source, its slot (holding stale data) is handed back to the writer
+	std::swap(this->previous, this->snapshots[this->front]);
+	this->front = this->ready.exchange(this->front, std::memory_order_acq_rel) & ~freshBit;
+}
+
+Simulation::StepFunction createGravityStep(Eigen::Index bodyCount, std::string const & integrator, double gravitationalConstant, double softening, bool collisions)
+{
+	std::shared_ptr<Integrator> stepper = createIntegrator(integrator);
+	if(!stepper)
+		return nullptr;
+	std::shared_ptr<GravitySolver> gravity = createGravitySolver(bodyCount, gravitationalConstant, softening);
+	std::shared_ptr<CollisionSolver> collisionSolver;
+	if(collisions)
+		collisionSolver = std::make_shared<CollisionSolver>();
+
+	return [gravity, stepper, collisionSolver] (BodyState & state, double dt) {
+		stepper->step(state, dt, [&] (Eigen::ArrayX3d const & position, Eigen::ArrayX3d & acceleration) {
+			gravity->computeAccelerations(position, state.mass, acceleration);
+		});
+		if(collisionSolver && collisionSolver->resolve(state) > 0)
+			stepper->invalidate();
+	};
+}
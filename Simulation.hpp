@@ -0,0 +1,86 @@
+#pragma once
+
+#include "BodyState.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Simulation
+{
+public:
+	using StepFunction = std::function<void(BodyState & state, double dt)>;
+
+	Simulation(BodyState initialState, StepFunction step, double timeStep = 1. / 120);
+	~Simulation();
+
+	Simulation(Simulation const &) = delete;
+	Simulation & operator=(Simulation const &) = delete;
+
+	// called on the worker thread after every published state, has to be set before start()
+	void setPublishCallback(std::function<void()> callback);
+	// called on the worker thread with the state after every step, has to be set before start()
+	void setStepCallback(std::function<void(BodyState const & state)> callback);
+
+	void start();
+	void stop();
+
+	void setPaused(bool paused);
+	bool isPaused() const;
+
+	double timeStep() const;
+
+	// wall clock seconds spent in each step function call since the last call, for benchmarking
+	std::vector<double> takeStepTimes();
+
+	// interpolates between the two most recent snapshots to the current wall clock time, must only be called from a single (render) thread
+	void interpolatedState(BodyState & state);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Snapshot
+	{
+		BodyState state;
+		Clock::time_point published;
+	};
+
+	void run();
+	void publish();
+	void acquire();
+
+	StepFunction step;
+	std::function<void()> publishCallback;
+	std::function<void(BodyState const &)> stepCallback;
+	double dt;
+
+	// owned by the worker thread
+	BodyState state;
+	unsigned back;
+
+	// triple buffer, the latest published index is tagged with freshBit until the reader picks it up
+	static constexpr unsigned freshBit = 4;
+	std::array<Snapshot, 3> snapshots;
+	std::atomic<unsigned> ready;
+
+	// owned by the reader
+	unsigned front;
+	Snapshot previous;
+
+	std::atomic<bool> running, paused;
+	std::mutex pauseMutex;
+	std::condition_variable pauseCondition;
+	std::thread worker;
+
+	std::mutex stepTimesMutex;
+	std::vector<double> stepTimes;
+};
+
+// gravity advanced by the named integrator followed by the collision response, returns an empty function for unknown integrators
+Simulation::StepFunction createGravityStep(Eigen::Index bodyCount, std::string const & integrator, double gravitationalConstant = 1, double softening = 0, bool collisions = true);
@@ -0,0 +1,356 @@
+#include "SimulationRecording.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	// like the other cache files, recordings are native byte order
+	struct Header
+	{
+		char magic[8];
+		std::uint32_t version, stepsPerChunk;
+		std::uint64_t bodies;
+		double timeStep, quantum;
+	};
+
+	// precedes the encoded steps of every chunk
+	struct ChunkHeader
+	{
+		char magic[4];
+		std::uint32_t steps;
+		std::uint64_t size;
+	};
+
+	struct Footer
+	{
+		std::uint64_t indexOffset, steps;
+		char magic[8];
+	};
+}
+
+static char const recordingMagic[8] = {'S', 'I', 'M', 'R', 'E', 'C', 'O', 'R'};
+static char const chunkMagic[4] = {'C', 'H', 'N', 'K'};
+static constexpr std::uint32_t recordingVersion = 2;
+
+static void writeVarint(QByteArray & out, std::int64_t value)
+{
+	// zigzag keeps small negative values small
+	auto encoded = (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+	while(encoded >= 0x80)
+	{
+		out.append(static_cast<char>(encoded | 0x80));
+		encoded >>= 7;
+	}
+	out.append(static_cast<char>(encoded));
+}
+
+static bool readVarint(unsigned char const * & in, unsigned char const * end, std::int64_t & value)
+{
+	std::uint64_t encoded = 0;
+	for(int shift = 0; shift < 64; shift += 7)
+	{
+		if(in == end)
+			return false;
+		auto byte = *in++;
+		encoded |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+		if(!(byte & 0x80))
+		{
+			value = static_cast<std::int64_t>(encoded >> 1) ^ -static_cast<std::int64_t>(encoded & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+RecordingWriter::RecordingWriter(QString const & path, BodyState const & initial, double timeStep, double quantum, int stepsPerChunk)
+	: file{path}
+	, bodies{initial.size()}
+	, quantum{quantum}
+	, stepsPerChunk{stepsPerChunk}
+	, steps{0}
+	, chunkSteps{0}
+{
+	if(!this->file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return;
+
+	Header header;
+	std::memcpy(header.magic, recordingMagic, sizeof(recordingMagic));
+	header.version = recordingVersion;
+	header.stepsPerChunk = stepsPerChunk;
+	header.bodies = this->bodies;
+	header.timeStep = timeStep;
+	header.quantum = quantum;
+	this->file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+
+	Eigen::ArrayXd mass = initial.mass, radius = initial.radius;
+	Eigen::Array<std::int32_t, Eigen::Dynamic, 1> texture = initial.texture.cast<std::int32_t>();
+	this->file.write(reinterpret_cast<char const *>(mass.data()), sizeof(double) * this->bodies);
+	this->file.write(reinterpret_cast<char const *>(radius.data()), sizeof(double) * this->bodies);
+	this->file.write(reinterpret_cast<char const *>(texture.data()), sizeof(std::int32_t) * this->bodies);
+
+	this->append(initial);
+}
+
+RecordingWriter::~RecordingWriter()
+{
+	this->finish();
+}
+
+bool RecordingWriter::isOpen() const
+{
+	return this->file.isOpen();
+}
+
+void RecordingWriter::append(BodyState const & state)
+{
+	if(!this->file.isOpen() || state.size() != this->bodies)
+		return;
+
+	this->current = (state.position / this->quantum).round().cast<std::int64_t>();
+
+	this->chunk.append(reinterpret_cast<char const *>(&state.time), sizeof(double));
+	for(int c = 0; c < 3; ++c)
+	{
+		for(Eigen::Index i = 0; i < this->bodies; ++i)
+		{
+			auto value = this->current(i, c);
+			if(this->chunkSteps == 1)
+				value -= this->previous(i, c);
+			else if(this->chunkSteps > 1)
+				value -= 2 * this->previous(i, c) - this->beforePrevious(i, c);
+			writeVarint(this->chunk, value);
+		}
+	}
+
+	this->beforePrevious.swap(this->previous);
+	this->previous.swap(this->current);
+	++this->steps;
+	if(++this->chunkSteps == this->stepsPerChunk)
+		this->flushChunk();
+}
+
+void RecordingWriter::finish()
+{
+	if(!this->file.isOpen())
+		return;
+
+	this->flushChunk();
+
+	Footer footer;
+	footer.indexOffset = static_cast<std::uint64_t>(this->file.pos());
+	footer.steps = this->steps;
+	std::memcpy(footer.magic, recordingMagic, sizeof(recordingMagic));
+	this->file.write(reinterpret_cast<char const *>(this->chunkOffsets.data()), sizeof(std::uint64_t) * this->chunkOffsets.size());
+	this->file.write(reinterpret_cast<char const *>(&footer), sizeof(footer));
+	this->file.close();
+}
+
+void RecordingWriter::flushChunk()
+{
+	if(this->chunkSteps == 0)
+		return;
+
+	ChunkHeader header;
+	std::memcpy(header.magic, chunkMagic, sizeof(chunkMagic));
+	header.steps = static_cast<std::uint32_t>(this->chunkSteps);
+	header.size = static_cast<std::uint64_t>(this->chunk.size());
+
+	this->chunkOffsets.push_back(static_cast<std::uint64_t>(this->file.pos()));
+	this->file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+	this->file.write(this->chunk);
+	// a crash loses at most the chunk being recorded
+	this->file.flush();
+	this->chunk.clear();
+	this->chunkSteps = 0;
+}
+
+RecordingReader::RecordingReader(QString const & path)
+	: file{path}
+	, data{nullptr}
+	, size{0}
+	, bodies{0}
+	, dt{0}
+	, quantum{0}
+	, stepsPerChunk{0}
+	, steps{0}
+	, staticOffset{0}
+{
+	if(!this->file.open(QIODevice::ReadOnly))
+		return;
+
+	auto size = static_cast<std::uint64_t>(this->file.size());
+	auto data = size >= sizeof(Header) ? this->file.map(0, size) : nullptr;
+	if(!data)
+		return;
+
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+
+	// bodies is bounded first so the static size cannot overflow
+	auto bodySize = 2 * sizeof(double) + sizeof(std::int32_t);
+	if(std::memcmp(header.magic, recordingMagic, sizeof(recordingMagic)) != 0 || header.version != recordingVersion
+		|| header.stepsPerChunk == 0 || header.stepsPerChunk > static_cast<std::uint32_t>(std::numeric_limits<int>::max()) || header.bodies > (size - sizeof(Header)) / bodySize)
+	{
+		this->file.unmap(data);
+		return;
+	}
+
+	this->data = data;
+	this->size = size;
+	this->stepsPerChunk = static_cast<int>(header.stepsPerChunk);
+
+	auto chunksBegin = sizeof(Header) + bodySize * header.bodies;
+	if(!this->readIndex(chunksBegin))
+		this->scanChunks(chunksBegin);
+	if(this->chunks.empty())
+	{
+		this->file.unmap(data);
+		this->data = nullptr;
+		this->size = 0;
+		return;
+	}
+
+	this->bodies = static_cast<Eigen::Index>(header.bodies);
+	this->dt = header.timeStep;
+	this->quantum = header.quantum;
+	this->staticOffset = sizeof(Header);
+}
+
+bool RecordingReader::readIndex(std::uint64_t chunksBegin)
+{
+	if(this->size < chunksBegin + sizeof(Footer))
+		return false;
+
+	Footer footer;
+	std::memcpy(&footer, this->data + this->size - sizeof(footer), sizeof(footer));
+	auto indexEnd = this->size - sizeof(Footer);
+	if(std::memcmp(footer.magic, recordingMagic, sizeof(recordingMagic)) != 0 || footer.indexOffset < chunksBegin || footer.indexOffset > indexEnd)
+		return false;
+
+	auto count = (footer.steps + this->stepsPerChunk - 1) / this->stepsPerChunk;
+	if(count == 0 || count != (indexEnd - footer.indexOffset) / sizeof(std::uint64_t) || footer.indexOffset + sizeof(std::uint64_t) * count != indexEnd)
+		return false;
+
+	std::vector<std::uint64_t> offsets(static_cast<std::size_t>(count));
+	std::memcpy(offsets.data(), this->data + footer.indexOffset, sizeof(std::uint64_t) * count);
+
+	// every chunk has to lie between the static data and the index, in order, and hold as many steps as its position implies
+	std::vector<ChunkRange> chunks;
+	chunks.reserve(offsets.size());
+	auto limit = chunksBegin;
+	for(std::size_t c = 0; c < offsets.size(); ++c)
+	{
+		auto offset = offsets[c];
+		if(offset < limit || offset > footer.indexOffset || footer.indexOffset - offset < sizeof(ChunkHeader))
+			return false;
+
+		ChunkHeader header;
+		std::memcpy(&header, this->data + offset, sizeof(header));
+		auto expectedSteps = c + 1 < offsets.size() ? static_cast<std::uint64_t>(this->stepsPerChunk) : footer.steps - c * this->stepsPerChunk;
+		auto begin = offset + sizeof(ChunkHeader);
+		if(std::memcmp(header.magic, chunkMagic, sizeof(chunkMagic)) != 0 || header.steps != expectedSteps || header.size > footer.indexOffset - begin)
+			return false;
+
+		chunks.push_back({begin, begin + header.size});
+		limit = begin + header.size;
+	}
+
+	this->chunks = std::move(chunks);
+	this->steps = static_cast<std::int64_t>(footer.steps);
+	return true;
+}
+
+void RecordingReader::scanChunks(std::uint64_t chunksBegin)
+{
+	// the writer did not finish, take the complete chunks up to the first torn or partial one
+	this->chunks.clear();
+	this->steps = 0;
+	for(auto offset = chunksBegin; this->size - offset >= sizeof(ChunkHeader);)
+	{
+		ChunkHeader header;
+		std::memcpy(&header, this->data + offset, sizeof(header));
+		auto begin = offset + sizeof(ChunkHeader);
+		if(std::memcmp(header.magic, chunkMagic, sizeof(chunkMagic)) != 0 || header.steps == 0 || header.steps > static_cast<std::uint32_t>(this->stepsPerChunk)
+			|| header.size > this->size - begin)
+			break;
+
+		this->chunks.push_back({begin, begin + header.size});
+		this->steps += header.steps;
+		// only the last chunk is short
+		if(header.steps < static_cast<std::uint32_t>(this->stepsPerChunk))
+			break;
+		offset = begin + header.size;
+	}
+}
+
+bool RecordingReader::isValid() const
+{
+	return this->data != nullptr;
+}
+
+std::int64_t RecordingReader::stepCount() const
+{
+	return this->steps;
+}
+
+double RecordingReader::timeStep() const
+{
+	return this->dt;
+}
+
+bool RecordingReader::readStep(std::int64_t step, BodyState & state) const
+{
+	if(!this->data || step < 0 || step >= this->steps)
+		return false;
+
+	auto n = this->bodies;
+	if(state.size() != n)
+	{
+		state.resize(n);
+		state.velocity.setZero();
+	}
+
+	auto statics = this->data + this->staticOffset;
+	std::memcpy(state.mass.data(), statics, sizeof(double) * n);
+	std::memcpy(state.radius.data(), statics + sizeof(double) * n, sizeof(double) * n);
+	Eigen::Array<std::int32_t, Eigen::Dynamic, 1> texture(n);
+	std::memcpy(texture.data(), statics + 2 * sizeof(double) * n, sizeof(std::int32_t) * n);
+	state.texture = texture.cast<int>();
+
+	auto chunk = static_cast<std::size_t>(step / this->stepsPerChunk);
+	auto local = step % this->stepsPerChunk;
+	auto in = this->data + this->chunks[chunk].begin;
+	auto end = this->data + this->chunks[chunk].end;
+
+	Eigen::Array<std::int64_t, Eigen::Dynamic, 3> current(n, 3), previous(n, 3), beforePrevious(n, 3);
+	for(std::int64_t s = 0; s <= local; ++s)
+	{
+		if(end - in < static_cast<std::ptrdiff_t>(sizeof(double)))
+			return false;
+		std::memcpy(&state.time, in, sizeof(double));
+		in += sizeof(double);
+
+		for(int c = 0; c < 3; ++c)
+		{
+			for(Eigen::Index i = 0; i < n; ++i)
+			{
+				std::int64_t value;
+				if(!readVarint(in, end, value))
+					return false;
+				if(s == 1)
+					value += previous(i, c);
+				else if(s > 1)
+					value += 2 * previous(i, c) - beforePrevious(i, c);
+				current(i, c) = value;
+			}
+		}
+
+		beforePrevious.swap(previous);
+		previous.swap(current);
+	}
+
+	state.position = previous.cast<double>() * this->quantum;
+	return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "BodyState.hpp"
+
+#include <QFile>
+#include <QString>
+
+#include <cstdint>
+#include <vector>
+
+// A recording stores mass, radius and texture once and the positions of every step quantized to a fixed grid.
+// Steps are grouped into chunks of stepsPerChunk: the first step of a chunk is stored absolutely, the second as the difference to the first,
+// all later ones as the residual of a linear extrapolation from the two previous steps, each as a zigzag varint.
+// An index of chunk offsets at the end of the file gives random access: any step decodes in at most stepsPerChunk steps.
+// Each chunk starts with its own small header and is flushed when complete, so the chunks of a recording cut short by a crash are found by scanning.
+
+class RecordingWriter
+{
+public:
+	// the initial state is recorded as step 0
+	RecordingWriter(QString const & path, BodyState const & initial, double timeStep, double quantum = 1e-6, int stepsPerChunk = 64);
+	~RecordingWriter();
+
+	RecordingWriter(RecordingWriter const &) = delete;
+	RecordingWriter & operator=(RecordingWriter const &) = delete;
+
+	bool isOpen() const;
+
+	void append(BodyState const & state);
+	// writes the pending chunk and the index, without it only the chunks completed so far can be read back
+	void finish();
+
+private:
+	using QuantizedPositions = Eigen::Array<std::int64_t, Eigen::Dynamic, 3>;
+
+	void flushChunk();
+
+	QFile file;
+	Eigen::Index bodies;
+	double quantum;
+	int stepsPerChunk;
+
+	std::vector<std::uint64_t> chunkOffsets;
+	std::uint64_t steps;
+
+	QByteArray chunk;
+	int chunkSteps;
+	QuantizedPositions current, previous, beforePrevious;
+};
+
+class RecordingReader
+{
+public:
+	explicit RecordingReader(QString const & path);
+
+	RecordingReader(RecordingReader const &) = delete;
+	RecordingReader & operator=(RecordingReader const &) = delete;
+
+	bool isValid() const;
+
+	std::int64_t stepCount() const;
+	double timeStep() const;
+
+	// sets positions and time of the given step, plus mass, radius and texture; velocities are not recorded and left at zero
+	bool readStep(std::int64_t step, BodyState & state) const;
+
+private:
+	// where the encoded steps of a chunk begin and end in the file
+	struct ChunkRange
+	{
+		std::uint64_t begin, end;
+	};
+
+	bool readIndex(std::uint64_t chunksBegin);
+	void scanChunks(std::uint64_t chunksBegin);
+
+	QFile file;
+	unsigned char const * data;
+	std::uint64_t size;
+
+	Eigen::Index bodies;
+	double dt, quantum;
+	int stepsPerChunk;
+	std::int64_t steps;
+	std::uint64_t staticOffset;
+	std::vector<ChunkRange> chunks;
+};
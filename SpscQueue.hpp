@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// a bounded lock-free ring buffer for exactly one producing and one consuming thread
+template<class T, std::size_t Capacity>
+class SpscQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "the capacity has to be a power of two");
+
+public:
+	SpscQueue()
+		: head{0}
+		, tail{0}
+	{}
+
+	SpscQueue(SpscQueue const &) = delete;
+	SpscQueue & operator=(SpscQueue const &) = delete;
+
+	// producer only, false if the queue is full
+	bool push(T const & value)
+	{
+		auto tail = this->tail.load(std::memory_order_relaxed);
+		if(tail - this->head.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		this->slots[tail & (Capacity - 1)] = value;
+		this->tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only, false if the queue is empty
+	bool pop(T & value)
+	{
+		auto head = this->head.load(std::memory_order_relaxed);
+		if(head == this->tail.load(std::memory_order_acquire))
+			return false;
+
+		value = this->slots[head & (Capacity - 1)];
+		this->head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	std::array<T, Capacity> slots;
+	// on separate cache lines, each index is only written by one side
+	alignas(64) std::atomic<std::size_t> head;
+	alignas(64) std::atomic<std::size_t> tail;
+};
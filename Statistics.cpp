@@ -0,0 +1,28 @@
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+QJsonObject summarizeDurations(std::vector<double> seconds)
+{
+	QJsonObject result;
+	result["count"] = static_cast<int>(seconds.size());
+	if(seconds.empty())
+		return result;
+
+	std::sort(seconds.begin(), seconds.end());
+	// nearest rank percentile
+	auto percentile = [&seconds] (double p) {
+		auto rank = static_cast<std::size_t>(std::ceil(p * seconds.size()));
+		return 1e3 * seconds[std::max<std::size_t>(rank, 1) - 1];
+	};
+
+	result["mean"] = 1e3 * std::accumulate(seconds.begin(), seconds.end(), 0.) / seconds.size();
+	result["median"] = percentile(0.5);
+	result["p95"] = percentile(0.95);
+	result["p99"] = percentile(0.99);
+	result["min"] = 1e3 * seconds.front();
+	result["max"] = 1e3 * seconds.back();
+	return result;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <QJsonObject>
+
+#include <vector>
+
+// count, mean, median, 95th and 99th percentile, minimum and maximum of durations given in seconds, reported in milliseconds
+QJsonObject summarizeDurations(std::vector<double> seconds);
@@ -0,0 +1,129 @@
+#include "StreamingBuffer.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// frames of the largest write so far that fit after growing, enough for the usual two or three frames the driver queues
+static constexpr std::size_t framesPerCapacity = 4;
+
+StreamingBuffer::StreamingBuffer(GLenum target, std::size_t capacity)
+	: target{target}
+	, buffer{0}
+	, size{std::max<std::size_t>(capacity, 1)}
+	, head{0}
+	, inFlightBytes{0}
+	, frameBytes{0}
+{
+	glGenBuffers(1, &this->buffer);
+	glBindBuffer(this->target, this->buffer);
+	glBufferData(this->target, static_cast<GLsizeiptr>(this->size), nullptr, GL_STREAM_DRAW);
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+	for(auto const & frame : this->frames)
+		glDeleteSync(frame.fence);
+	glDeleteBuffers(1, &this->buffer);
+}
+
+GLuint StreamingBuffer::bufferId() const
+{
+	return this->buffer;
+}
+
+std::size_t StreamingBuffer::capacity() const
+{
+	return this->size;
+}
+
+std::size_t StreamingBuffer::write(void const * data, std::size_t size, std::size_t alignment)
+{
+	PROFILE_ZONE("StreamingBuffer::write");
+
+	alignment = std::max<std::size_t>(alignment, 1);
+	auto placement = [&] (std::size_t & offset, std::size_t & padding) {
+		offset = (this->head + alignment - 1) / alignment * alignment;
+		// a write never straddles the end, the rest of the buffer is skipped instead
+		if(offset + size > this->size)
+			offset = 0;
+		padding = offset >= this->head ? offset - this->head : this->size - this->head;
+	};
+
+	std::size_t offset, padding;
+	placement(offset, padding);
+	while(this->inFlightBytes + this->frameBytes + padding + size > this->size && !this->frames.empty())
+		this->retireOldestFrame();
+
+	if(this->inFlightBytes + this->frameBytes + padding + size > this->size)
+	{
+		this->grow(framesPerCapacity * (size + alignment));
+		placement(offset, padding);
+	}
+
+	glBindBuffer(this->target, this->buffer);
+	if(size > 0)
+	{
+		// the fences guarantee the range is unused, invalidating it saves the driver from preserving its old contents
+		auto mapped = glMapBufferRange(this->target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if(mapped)
+		{
+			std::memcpy(mapped, data, size);
+			glUnmapBuffer(this->target);
+		}
+		else
+			glBufferSubData(this->target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+	}
+
+	this->frameBytes += padding + size;
+	this->head = offset + size;
+	PROFILE_COUNTER("streamed bytes", this->frameBytes);
+	return offset;
+}
+
+void StreamingBuffer::finishFrame()
+{
+	if(this->frameBytes == 0)
+		return;
+
+	this->frames.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), this->frameBytes});
+	this->inFlightBytes += this->frameBytes;
+	this->frameBytes = 0;
+}
+
+void StreamingBuffer::retireOldestFrame()
+{
+	PROFILE_ZONE("StreamingBuffer wait");
+
+	auto const & frame = this->frames.front();
+	// the first wait flushes, so the fence is guaranteed to be signaled eventually
+	GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	for(;;)
+	{
+		auto result = glClientWaitSync(frame.fence, flags, 1000000);
+		if(result != GL_TIMEOUT_EXPIRED)
+			break;
+		flags = 0;
+	}
+
+	glDeleteSync(frame.fence);
+	this->inFlightBytes -= frame.bytes;
+	this->frames.pop_front();
+}
+
+void StreamingBuffer::grow(std::size_t minimumCapacity)
+{
+	PROFILE_ZONE("StreamingBuffer::grow");
+
+	// reallocating orphans the old storage, draws still reading it keep their copy and no region is in flight in the new one
+	this->size = std::max(2 * this->size, minimumCapacity);
+	glBindBuffer(this->target, this->buffer);
+	glBufferData(this->target, static_cast<GLsizeiptr>(this->size), nullptr, GL_STREAM_DRAW);
+
+	for(auto const & frame : this->frames)
+		glDeleteSync(frame.fence);
+	this->frames.clear();
+	this->head = 0;
+	this->inFlightBytes = 0;
+	this->frameBytes = 0;
+}
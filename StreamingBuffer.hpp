@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <deque>
+
+// a ring of per-frame regions in one buffer object for data the CPU rewrites every frame: writes map their range with GL_MAP_UNSYNCHRONIZED_BIT,
+// so the driver neither stalls nor reallocates, and a fence per frame keeps the ring from wrapping onto data the GPU may still read
+// needs a current context during its whole lifetime
+class StreamingBuffer
+{
+public:
+	// the capacity should hold a few frames of data, writes that do not fit grow it
+	explicit StreamingBuffer(GLenum target = GL_ARRAY_BUFFER, std::size_t capacity = 1 << 20);
+	~StreamingBuffer();
+
+	StreamingBuffer(StreamingBuffer const &) = delete;
+	StreamingBuffer & operator=(StreamingBuffer const &) = delete;
+
+	GLuint bufferId() const;
+	std::size_t capacity() const;
+
+	// copies size bytes into the ring and returns their offset in the buffer (a multiple of alignment), leaves the buffer bound to the target
+	// growing discards what the frame wrote before, so a frame should write everything before its first draw reading it
+	std::size_t write(void const * data, std::size_t size, std::size_t alignment = 16);
+
+	// ends the frame's writes, call once the draws reading them were issued
+	void finishFrame();
+
+private:
+	struct Frame
+	{
+		GLsync fence;
+		// including the padding in front of the frame's writes
+		std::size_t bytes;
+	};
+
+	// blocks until the GPU is done with the oldest frame and releases its region
+	void retireOldestFrame();
+	void grow(std::size_t minimumCapacity);
+
+	GLenum target;
+	GLuint buffer;
+	std::size_t size;
+
+	// next free byte, and the bytes before it still in use by frames in flight and by the current frame
+	std::size_t head, inFlightBytes, frameBytes;
+	std::deque<Frame> frames;
+};
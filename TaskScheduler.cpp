@@ -0,0 +1,328 @@
+#include "TaskScheduler.hpp"
+
+#include <algorithm>
+#include <exception>
+
+class TaskScheduler::Task
+{
+public:
+	explicit Task(std::function<void()> work)
+		: work{std::move(work)}
+		, unfinishedDependencies{1}
+		, done{false}
+	{}
+
+	std::function<void()> work;
+	std::atomic<int> unfinishedDependencies;
+
+	std::mutex mutex;
+	std::condition_variable finished;
+	bool done;
+	std::exception_ptr exception;
+	std::vector<TaskHandle> continuations;
+};
+
+// the pool the current thread works for and its index there, null outside of any pool
+static thread_local TaskScheduler * currentScheduler = nullptr;
+static thread_local std::size_t currentWorker = 0;
+
+TaskScheduler & TaskScheduler::global()
+{
+	// at least one worker, tasks submitted from outside would otherwise only run when someone waits
+	static TaskScheduler scheduler{std::max(2u, std::thread::hardware_concurrency()) - 1};
+	return scheduler;
+}
+
+TaskScheduler::TaskScheduler(unsigned threads)
+	: queued{0}
+	, stopping{false}
+{
+	for(unsigned i = 0; i < threads; ++i)
+		this->workers.emplace_back(new Worker);
+	for(std::size_t i = 0; i < this->workers.size(); ++i)
+		this->workers[i]->thread = std::thread{&TaskScheduler::run, this, i};
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock{this->sleepMutex};
+		this->stopping = true;
+	}
+	this->sleepCondition.notify_all();
+	for(auto & worker : this->workers)
+		worker->thread.join();
+}
+
+unsigned TaskScheduler::threadCount() const
+{
+	return static_cast<unsigned>(this->workers.size());
+}
+
+TaskScheduler::TaskHandle TaskScheduler::submit(std::function<void()> work, std::vector<TaskHandle> const & dependencies)
+{
+	auto task = std::make_shared<Task>(std::move(work));
+	for(auto const & dependency : dependencies)
+	{
+		if(!dependency)
+			continue;
+
+		std::lock_guard<std::mutex> lock{dependency->mutex};
+		if(!dependency->done)
+		{
+			++task->unfinishedDependencies;
+			dependency->continuations.push_back(task);
+		}
+	}
+
+	// the initial count of one keeps the task from starting while dependencies are still being registered
+	if(--task->unfinishedDependencies == 0)
+		this->schedule(task);
+	return task;
+}
+
+void TaskScheduler::wait(TaskHandle const & task)
+{
+	if(!task)
+		return;
+
+	// running it here is what a worker would do, anything else queued is left alone
+	if(this->takeQueued(task))
+		this->execute(*task);
+
+	std::unique_lock<std::mutex> lock{task->mutex};
+	task->finished.wait(lock, [&task] { return task->done; });
+	if(task->exception)
+		std::rethrow_exception(task->exception);
+}
+
+void TaskScheduler::parallelFor(std::ptrdiff_t begin, std::ptrdiff_t end, std::ptrdiff_t grain, std::function<void(std::ptrdiff_t, std::ptrdiff_t)> const & body)
+{
+	auto count = end - begin;
+	if(count <= 0)
+		return;
+
+	grain = std::max<std::ptrdiff_t>(grain, 1);
+	auto chunks = count / grain;
+	if(chunks <= 1 || this->workers.empty())
+	{
+		body(begin, end);
+		return;
+	}
+
+	// helpers outlive the call if they start late, they only touch body after claiming a chunk, which is impossible once all are done
+	struct Range
+	{
+		std::function<void(std::ptrdiff_t, std::ptrdiff_t)> const * body;
+		std::ptrdiff_t begin, end, grain, chunks;
+		std::atomic<std::ptrdiff_t> next{0}, remaining;
+		std::atomic<bool> failed{false};
+
+		std::mutex mutex;
+		std::condition_variable finished;
+		std::exception_ptr exception;
+	};
+	auto range = std::make_shared<Range>();
+	range->body = &body;
+	range->begin = begin;
+	range->end = end;
+	range->grain = grain;
+	range->chunks = chunks;
+	range->remaining = chunks;
+
+	auto work = [range] {
+		for(auto chunk = range->next++; chunk < range->chunks; chunk = range->next++)
+		{
+			// after a failure the remaining chunks are only counted
+			if(!range->failed)
+			{
+				auto first = range->begin + chunk * range->grain;
+				auto last = chunk + 1 == range->chunks ? range->end : first + range->grain;
+				try
+				{
+					(*range->body)(first, last);
+				}
+				catch(...)
+				{
+					std::lock_guard<std::mutex> lock{range->mutex};
+					if(!range->exception)
+						range->exception = std::current_exception();
+					range->failed = true;
+				}
+			}
+
+			// taking the mutex orders the last decrement before the waiter's predicate check, so the wakeup cannot be lost
+			if(--range->remaining == 0)
+			{
+				std::lock_guard<std::mutex> lock{range->mutex};
+				range->finished.notify_all();
+			}
+		}
+	};
+
+	auto helpers = std::min<std::ptrdiff_t>(chunks - 1, this->workers.size());
+	for(std::ptrdiff_t i = 0; i < helpers; ++i)
+		this->submit(work);
+	work();
+
+	// every chunk is claimed, the ones still running on other threads cannot be helped with
+	std::unique_lock<std::mutex> lock{range->mutex};
+	range->finished.wait(lock, [&range] { return range->remaining == 0; });
+	if(range->exception)
+		std::rethrow_exception(range->exception);
+}
+
+void TaskScheduler::run(std::size_t index)
+{
+	currentScheduler = this;
+	currentWorker = index;
+
+	while(!this->stopping)
+	{
+		if(this->runOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock{this->sleepMutex};
+		this->sleepCondition.wait(lock, [this] { return this->queued > 0 || this->stopping; });
+	}
+}
+
+void TaskScheduler::schedule(TaskHandle task)
+{
+	if(currentScheduler == this)
+	{
+		auto & worker = *this->workers[currentWorker];
+		std::lock_guard<std::mutex> lock{worker.mutex};
+		worker.tasks.push_back(std::move(task));
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock{this->injectedMutex};
+		this->injected.push_back(std::move(task));
+	}
+
+	// taking the sleep mutex orders the increment before a worker's predicate check, so the wakeup cannot be lost
+	{
+		std::lock_guard<std::mutex> lock{this->sleepMutex};
+		++this->queued;
+	}
+	this->sleepCondition.notify_one();
+}
+
+void TaskScheduler::finish(Task & task)
+{
+	std::vector<TaskHandle> continuations;
+	{
+		std::lock_guard<std::mutex> lock{task.mutex};
+		task.done = true;
+		continuations.swap(task.continuations);
+	}
+	task.finished.notify_all();
+
+	for(auto & continuation : continuations)
+	{
+		if(--continuation->unfinishedDependencies == 0)
+			this->schedule(std::move(continuation));
+	}
+}
+
+bool TaskScheduler::runOne()
+{
+	auto task = this->take();
+	if(!task)
+		return false;
+
+	--this->queued;
+	this->execute(*task);
+	return true;
+}
+
+void TaskScheduler::execute(Task & task)
+{
+	// a throwing task still finishes, so waiters and continuations are not stuck, wait rethrows
+	try
+	{
+		task.work();
+	}
+	catch(...)
+	{
+		task.exception = std::current_exception();
+	}
+	// release captured state before anyone waiting on the task resumes
+	task.work = nullptr;
+	this->finish(task);
+}
+
+TaskScheduler::TaskHandle TaskScheduler::take()
+{
+	TaskHandle task;
+	auto own = currentScheduler == this ? currentWorker : this->workers.size();
+
+	// newest own task first, it is most likely still in cache
+	if(own < this->workers.size())
+	{
+		auto & worker = *this->workers[own];
+		std::lock_guard<std::mutex> lock{worker.mutex};
+		if(!worker.tasks.empty())
+		{
+			task = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+			return task;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{this->injectedMutex};
+		if(!this->injected.empty())
+		{
+			task = std::move(this->injected.front());
+			this->injected.pop_front();
+			return task;
+		}
+	}
+
+	// steal the oldest task of another worker, starting after our own index to spread the thieves
+	auto count = this->workers.size();
+	for(std::size_t i = 1; i <= count; ++i)
+	{
+		auto victim = (own + i) % count;
+		if(victim == own)
+			continue;
+
+		auto & worker = *this->workers[victim];
+		std::lock_guard<std::mutex> lock{worker.mutex};
+		if(!worker.tasks.empty())
+		{
+			task = std::move(worker.tasks.front());
+			worker.tasks.pop_front();
+			return task;
+		}
+	}
+	return task;
+}
+
+bool TaskScheduler::takeQueued(TaskHandle const & task)
+{
+	auto remove = [&task] (std::deque<TaskHandle> & tasks) {
+		auto position = std::find(tasks.begin(), tasks.end(), task);
+		if(position == tasks.end())
+			return false;
+		tasks.erase(position);
+		return true;
+	};
+
+	auto found = false;
+	{
+		std::lock_guard<std::mutex> lock{this->injectedMutex};
+		found = remove(this->injected);
+	}
+	for(std::size_t i = 0; i < this->workers.size() && !found; ++i)
+	{
+		std::lock_guard<std::mutex> lock{this->workers[i]->mutex};
+		found = remove(this->workers[i]->tasks);
+	}
+
+	if(found)
+		--this->queued;
+	return found;
+}
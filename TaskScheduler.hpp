@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads, each with its own deque: workers push and pop their own tasks LIFO and steal FIFO from the others when idle.
+// Tasks submitted from outside the pool go to a shared queue. A waiting thread only ever runs the work it waits for, never unrelated queued tasks,
+// so waiting for a short job cannot get stuck behind a long one (a texture decode on the simulation or render thread); otherwise it blocks.
+class TaskScheduler
+{
+public:
+	class Task;
+	using TaskHandle = std::shared_ptr<Task>;
+
+	// one worker less than the hardware threads (but at least one), the thread that waits works as well
+	static TaskScheduler & global();
+
+	explicit TaskScheduler(unsigned threads);
+	~TaskScheduler();
+
+	TaskScheduler(TaskScheduler const &) = delete;
+	TaskScheduler & operator=(TaskScheduler const &) = delete;
+
+	unsigned threadCount() const;
+
+	// work runs once every dependency finished, dependencies may be null or already finished
+	TaskHandle submit(std::function<void()> work, std::vector<TaskHandle> const & dependencies = {});
+	// runs the task on the calling thread if it was not started yet, blocks until it finished otherwise; rethrows what the task threw
+	void wait(TaskHandle const & task);
+
+	// splits [begin, end) into chunks of at least grain elements (the remainder goes to the last one) that the calling thread and idle workers claim one at a time,
+	// rethrows the first exception a chunk threw once all chunks are done or skipped
+	void parallelFor(std::ptrdiff_t begin, std::ptrdiff_t end, std::ptrdiff_t grain, std::function<void(std::ptrdiff_t, std::ptrdiff_t)> const & body);
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<TaskHandle> tasks;
+		std::thread thread;
+	};
+
+	void run(std::size_t index);
+	void schedule(TaskHandle task);
+	void finish(Task & task);
+	// runs one queued task if there is any
+	bool runOne();
+	void execute(Task & task);
+	TaskHandle take();
+	// removes the task from the queue holding it, false if it is not queued
+	bool takeQueued(TaskHandle const & task);
+
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	std::mutex injectedMutex;
+	std::deque<TaskHandle> injected;
+
+	// sleeping workers wait for queued to become positive
+	std::atomic<std::ptrdiff_t> queued;
+	std::atomic<bool> stopping;
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+};
@@ -0,0 +1,122 @@
+#include "TextureCache.hpp"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	// like IcosphereCache the file is only read back on the machine that wrote it
+	struct Header
+	{
+		char magic[8];
+		std::uint32_t version, encoderVersion, levels;
+		// SHA-1 of the encoded source image
+		char sourceHash[20];
+	};
+
+	struct StoredLevel
+	{
+		std::uint32_t width, height;
+		std::uint64_t offset, size;
+	};
+}
+
+static char const cacheMagic[8] = {'B', 'C', '1', 'M', 'I', 'P', 'S', '\0'};
+// bump whenever the file layout changes, encoder changes go into textureEncoderVersion
+static constexpr std::uint32_t cacheVersion = 2;
+
+static QString cachePath(QString const & cacheName)
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/textures/" + cacheName + ".bc1";
+}
+
+static bool read(QString const & path, QByteArray const & sourceHash, TextureLevels & texture)
+{
+	QFile file{path};
+	if(!file.open(QIODevice::ReadOnly))
+		return false;
+
+	auto contents = file.readAll();
+	if(static_cast<std::size_t>(contents.size()) < sizeof(Header))
+		return false;
+
+	Header header;
+	std::memcpy(&header, contents.constData(), sizeof(header));
+	if(std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion || header.encoderVersion != textureEncoderVersion
+		|| static_cast<std::size_t>(sourceHash.size()) != sizeof(header.sourceHash) || std::memcmp(header.sourceHash, sourceHash.constData(), sizeof(header.sourceHash)) != 0)
+		return false;
+
+	auto dataOffset = sizeof(Header) + header.levels * sizeof(StoredLevel);
+	if(static_cast<std::size_t>(contents.size()) < dataOffset)
+		return false;
+
+	auto stored = reinterpret_cast<StoredLevel const *>(contents.constData() + sizeof(Header));
+	std::size_t dataSize = contents.size() - dataOffset;
+	texture.format = TextureLevels::Format::BC1;
+	texture.levels.clear();
+	for(std::uint32_t level = 0; level < header.levels; ++level)
+	{
+		if(stored[level].offset + stored[level].size > dataSize)
+			return false;
+		texture.levels.push_back({static_cast<int>(stored[level].width), static_cast<int>(stored[level].height), static_cast<std::size_t>(stored[level].offset), static_cast<std::size_t>(stored[level].size)});
+	}
+	texture.data = contents.mid(static_cast<int>(dataOffset));
+	return !texture.isNull();
+}
+
+static void write(QString const & path, QByteArray const & sourceHash, TextureLevels const & texture)
+{
+	QDir{}.mkpath(QFileInfo{path}.absolutePath());
+
+	QSaveFile out{path};
+	if(!out.open(QIODevice::WriteOnly))
+		return;
+
+	Header header;
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.levels = static_cast<std::uint32_t>(texture.levels.size());
+	header.encoderVersion = textureEncoderVersion;
+	std::memcpy(header.sourceHash, sourceHash.constData(), sizeof(header.sourceHash));
+	out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+
+	for(auto const & level : texture.levels)
+	{
+		StoredLevel stored{static_cast<std::uint32_t>(level.width), static_cast<std::uint32_t>(level.height), level.offset, level.size};
+		out.write(reinterpret_cast<char const *>(&stored), sizeof(stored));
+	}
+
+	out.write(texture.data);
+	out.commit();
+}
+
+TextureLevels loadCachedTexture(QString const & source, QString const & cacheName, std::function<QImage(QImage)> const & convert)
+{
+	// sizes and modification times of resources are meaningless, hashing the source is cheap next to decoding and compressing it
+	QFile sourceFile{source};
+	if(!sourceFile.open(QIODevice::ReadOnly))
+		return {};
+	auto sourceData = sourceFile.readAll();
+	auto sourceHash = QCryptographicHash::hash(sourceData, QCryptographicHash::Sha1);
+	auto path = cachePath(cacheName);
+
+	TextureLevels texture;
+	if(read(path, sourceHash, texture))
+		return texture;
+
+	auto image = QImage::fromData(sourceData);
+	if(convert)
+		image = convert(std::move(image));
+
+	texture = createTextureLevels(image, TextureLevels::Format::BC1);
+	if(!texture.isNull())
+		write(path, sourceHash, texture);
+	return texture;
+}
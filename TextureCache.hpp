@@ -0,0 +1,12 @@
+#pragma once
+
+#include "TextureCompression.hpp"
+
+#include <QString>
+
+#include <functional>
+
+// BC1 mip chains are written to a KTX-like file in the cache directory the first time a texture is loaded and read back on later startups,
+// the file is rebuilt when the bytes of the source image or the encoder version change, so it works for resources as well as files
+// cacheName has to be unique for each source and convert pair, convert runs on the decoded image before the mip chain is built
+TextureLevels loadCachedTexture(QString const & source, QString const & cacheName, std::function<QImage(QImage)> const & convert);
@@ -0,0 +1,166 @@
+#include "TextureCompression.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+static std::uint16_t packRGB565(int const * rgb)
+{
+	return static_cast<std::uint16_t>((rgb[0] * 31 + 127) / 255 << 11 | (rgb[1] * 63 + 127) / 255 << 5 | (rgb[2] * 31 + 127) / 255);
+}
+
+static void unpackRGB565(std::uint16_t color, int * rgb)
+{
+	auto r = color >> 11 & 31, g = color >> 5 & 63, b = color & 31;
+	rgb[0] = r << 3 | r >> 2;
+	rgb[1] = g << 2 | g >> 4;
+	rgb[2] = b << 3 | b >> 2;
+}
+
+// endpoints from the inset bounding box of the block, flipped along the axes that correlate negatively with green (van Waveren 2006)
+void compressBC1Block(unsigned char const * texels, unsigned char * block)
+{
+	int minimum[3] = {255, 255, 255}, maximum[3] = {0, 0, 0}, sum[3] = {0, 0, 0};
+	for(int i = 0; i < 16; ++i)
+	{
+		for(int c = 0; c < 3; ++c)
+		{
+			minimum[c] = std::min<int>(minimum[c], texels[4 * i + c]);
+			maximum[c] = std::max<int>(maximum[c], texels[4 * i + c]);
+			sum[c] += texels[4 * i + c];
+		}
+	}
+
+	int covarianceRG = 0, covarianceBG = 0;
+	for(int i = 0; i < 16; ++i)
+	{
+		auto g = 16 * texels[4 * i + 1] - sum[1];
+		covarianceRG += (16 * texels[4 * i] - sum[0]) * g;
+		covarianceBG += (16 * texels[4 * i + 2] - sum[2]) * g;
+	}
+	if(covarianceRG < 0)
+		std::swap(minimum[0], maximum[0]);
+	if(covarianceBG < 0)
+		std::swap(minimum[2], maximum[2]);
+
+	// pulling the endpoints in by 1/16 of the range lowers the error of the interpolated colors
+	for(int c = 0; c < 3; ++c)
+	{
+		auto inset = (maximum[c] - minimum[c]) / 16;
+		maximum[c] -= inset;
+		minimum[c] += inset;
+	}
+
+	auto color0 = packRGB565(maximum), color1 = packRGB565(minimum);
+	// color0 > color1 selects the four color mode
+	if(color0 < color1)
+		std::swap(color0, color1);
+
+	std::uint32_t indices = 0;
+	if(color0 != color1)
+	{
+		int palette[4][3];
+		unpackRGB565(color0, palette[0]);
+		unpackRGB565(color1, palette[1]);
+		for(int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for(int i = 0; i < 16; ++i)
+		{
+			std::uint32_t best = 0;
+			auto bestDistance = 0x7fffffff;
+			for(std::uint32_t p = 0; p < 4; ++p)
+			{
+				auto distance = 0;
+				for(int c = 0; c < 3; ++c)
+				{
+					auto d = texels[4 * i + c] - palette[p][c];
+					distance += d * d;
+				}
+				if(distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= best << 2 * i;
+		}
+	}
+
+	block[0] = static_cast<unsigned char>(color0);
+	block[1] = static_cast<unsigned char>(color0 >> 8);
+	block[2] = static_cast<unsigned char>(color1);
+	block[3] = static_cast<unsigned char>(color1 >> 8);
+	for(int i = 0; i < 4; ++i)
+		block[4 + i] = static_cast<unsigned char>(indices >> 8 * i);
+}
+
+static std::size_t levelSize(int width, int height, TextureLevels::Format format)
+{
+	if(format == TextureLevels::Format::BC1)
+		return 8 * static_cast<std::size_t>((width + 3) / 4) * static_cast<std::size_t>((height + 3) / 4);
+	return 4 * static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+}
+
+static void compressBC1(QImage const & image, unsigned char * out)
+{
+	auto width = image.width(), height = image.height();
+	unsigned char texels[64];
+	for(int y = 0; y < height; y += 4)
+	{
+		for(int x = 0; x < width; x += 4)
+		{
+			// blocks reaching over the edge of small levels repeat the last row and column
+			for(int by = 0; by < 4; ++by)
+			{
+				auto row = image.constScanLine(std::min(y + by, height - 1));
+				for(int bx = 0; bx < 4; ++bx)
+					std::memcpy(texels + 4 * (4 * by + bx), row + 4 * std::min(x + bx, width - 1), 4);
+			}
+			compressBC1Block(texels, out);
+			out += 8;
+		}
+	}
+}
+
+TextureLevels createTextureLevels(QImage const & image, TextureLevels::Format format)
+{
+	TextureLevels result;
+	result.format = format;
+	if(image.isNull())
+		return result;
+
+	auto level = image.convertToFormat(QImage::Format_RGBA8888);
+	std::size_t total = 0;
+	for(int width = level.width(), height = level.height();; width = std::max(1, width / 2), height = std::max(1, height / 2))
+	{
+		auto size = levelSize(width, height, format);
+		result.levels.push_back({width, height, total, size});
+		total += size;
+		if(width == 1 && height == 1)
+			break;
+	}
+
+	result.data.resize(static_cast<int>(total));
+	auto data = reinterpret_cast<unsigned char *>(result.data.data());
+	for(std::size_t i = 0; i < result.levels.size(); ++i)
+	{
+		auto const & info = result.levels[i];
+		// smooth scaling of an image with alpha returns ARGB32_Premultiplied, which is BGRA in memory on little endian machines
+		if(i > 0)
+			level = level.scaled(info.width, info.height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(QImage::Format_RGBA8888);
+
+		if(format == TextureLevels::Format::BC1)
+			compressBC1(level, data + info.offset);
+		else
+		{
+			for(int y = 0; y < info.height; ++y)
+				std::memcpy(data + info.offset + 4 * static_cast<std::size_t>(info.width) * y, level.constScanLine(y), 4 * static_cast<std::size_t>(info.width));
+		}
+	}
+	return result;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// complete mip chain of one 2D image, the levels are stored back to back in data
+struct TextureLevels
+{
+	enum class Format
+	{
+		RGBA8,
+		// S3TC DXT1, 8 bytes per 4x4 block of opaque RGB texels
+		BC1
+	};
+
+	struct Level
+	{
+		int width, height;
+		std::size_t offset, size;
+	};
+
+	Format format = Format::RGBA8;
+	std::vector<Level> levels;
+	QByteArray data;
+
+	bool isNull() const { return this->levels.empty(); }
+};
+
+// bump whenever compressBC1Block or the mip filter changes their output, cached textures are keyed on it
+constexpr std::uint32_t textureEncoderVersion = 2;
+
+// encodes 16 RGBA8888 texels in row-major order into one 8 byte BC1 block, alpha is ignored
+void compressBC1Block(unsigned char const * texels, unsigned char * block);
+
+// downsamples the image to 1x1 and stores every level in the given format, a null image gives empty levels
+TextureLevels createTextureLevels(QImage const & image, TextureLevels::Format format);
@@ -0,0 +1,52 @@
+#include "TextureLoader.hpp"
+#include "TextureCache.hpp"
+#include "Profiler.hpp"
+#include "TaskScheduler.hpp"
+
+static TextureLevels loadTexture(QString const & path, QString const & cacheName, TextureLevels::Format format, std::function<QImage(QImage)> const & convert)
+{
+	PROFILE_ZONE("load texture");
+
+	if(format == TextureLevels::Format::BC1)
+		return loadCachedTexture(path, cacheName, convert);
+
+	QImage image{path};
+	if(convert)
+		image = convert(std::move(image));
+	return createTextureLevels(image, format);
+}
+
+TextureLoader::TextureLoader()
+	: shared{std::make_shared<Shared>()}
+{}
+
+void TextureLoader::load(int id, QString const & path, QString const & cacheName, TextureLevels::Format format, std::function<QImage(QImage)> convert)
+{
+	{
+		std::lock_guard<std::mutex> lock{this->shared->mutex};
+		++this->shared->pending;
+	}
+
+	auto shared = this->shared;
+	TaskScheduler::global().submit([shared, id, path, cacheName, format, convert] {
+		auto texture = loadTexture(path, cacheName, format, convert);
+
+		std::lock_guard<std::mutex> lock{shared->mutex};
+		shared->finished.push_back({id, std::move(texture)});
+	});
+}
+
+std::vector<TextureLoader::Image> TextureLoader::takeFinished()
+{
+	std::vector<Image> finished;
+	std::lock_guard<std::mutex> lock{this->shared->mutex};
+	finished.swap(this->shared->finished);
+	this->shared->pending -= static_cast<int>(finished.size());
+	return finished;
+}
+
+bool TextureLoader::isIdle() const
+{
+	std::lock_guard<std::mutex> lock{this->shared->mutex};
+	return this->shared->pending == 0;
+}
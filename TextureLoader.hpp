@@ -0,0 +1,42 @@
+#pragma once
+
+#include "TextureCompression.hpp"
+
+#include <QImage>
+#include <QString>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// decodes, converts and mip-maps images on the global task scheduler, the owner collects finished textures on its own (GL) thread
+class TextureLoader
+{
+public:
+	struct Image
+	{
+		int id;
+		TextureLevels texture;
+	};
+
+	TextureLoader();
+
+	// convert runs on the worker thread after decoding, id is handed back with the result
+	// BC1 textures go through the compressed texture cache under cacheName, RGBA8 textures are decoded every time
+	void load(int id, QString const & path, QString const & cacheName, TextureLevels::Format format, std::function<QImage(QImage)> convert = nullptr);
+
+	std::vector<Image> takeFinished();
+	bool isIdle() const;
+
+private:
+	struct Shared
+	{
+		std::mutex mutex;
+		std::vector<Image> finished;
+		int pending = 0;
+	};
+
+	// shared with the tasks so results of tasks outliving the loader are dropped safely
+	std::shared_ptr<Shared> shared;
+};
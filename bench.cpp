@@ -0,0 +1,407 @@
+#include <QCommandLineParser>
+#include <QColor>
+#include <QCoreApplication>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include "BarnesHut.hpp"
+#include "CameraMath.hpp"
+#include "Collisions.hpp"
+#include "Gravity.hpp"
+#include "Icosphere.hpp"
+#include "Integrators.hpp"
+#include "MeshOptimizer.hpp"
+#include "Parallel.hpp"
+#include "SceneGraph.hpp"
+#include "Statistics.hpp"
+#include "TextureCompression.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+// micro-benchmarks of the CPU hot paths without a window or an OpenGL context,
+// prints one JSON document with the same benchmark names and parameters on every run so results of different commits can be compared
+namespace
+{
+	class BenchmarkRunner
+	{
+	public:
+		BenchmarkRunner(double minimumSeconds, QString filter)
+			: minimumSeconds{minimumSeconds}
+			, filter{std::move(filter)}
+			, sink{0}
+		{}
+
+		// body runs batch times per sample and returns something derived from its result, so the compiler cannot drop the work
+		// setup runs untimed before every sample
+		void run(QString const & name, QJsonObject const & parameters, std::function<double()> const & body, int batch = 1, std::function<void()> const & setup = nullptr)
+		{
+			if(!name.contains(this->filter))
+				return;
+
+			using Clock = std::chrono::steady_clock;
+			std::vector<double> seconds;
+
+			// one untimed sample to warm up caches and allocators
+			if(setup)
+				setup();
+			for(int i = 0; i < batch; ++i)
+				this->sink += body();
+
+			auto start = Clock::now();
+			while(seconds.size() < minimumSamples || (std::chrono::duration<double>(Clock::now() - start).count() < this->minimumSeconds && seconds.size() < maximumSamples))
+			{
+				if(setup)
+					setup();
+				auto begin = Clock::now();
+				for(int i = 0; i < batch; ++i)
+					this->sink += body();
+				seconds.push_back(std::chrono::duration<double>(Clock::now() - begin).count() / batch);
+			}
+
+			QJsonObject result;
+			result["name"] = name;
+			result["parameters"] = parameters;
+			result["batch"] = batch;
+			result["timeMs"] = summarizeDurations(std::move(seconds));
+			this->results.append(result);
+
+			QTextStream{stderr} << name << ' ' << QJsonDocument{parameters}.toJson(QJsonDocument::Compact) << '\n';
+		}
+
+		QJsonArray const & benchmarks() const
+		{
+			return this->results;
+		}
+
+	private:
+		static constexpr std::size_t minimumSamples = 5;
+		static constexpr std::size_t maximumSamples = 100000;
+
+		double minimumSeconds;
+		QString filter;
+		QJsonArray results;
+		volatile double sink;
+	};
+}
+
+// the same flattened gaussian blob as --compare-gravity
+static BodyState createBlob(Eigen::Index bodyCount, std::uint32_t seed)
+{
+	std::mt19937 generator{seed};
+	std::normal_distribution<double> normal;
+
+	BodyState state;
+	state.resize(bodyCount);
+	for(Eigen::Index i = 0; i < bodyCount; ++i)
+	{
+		state.position.row(i) << normal(generator), normal(generator), 0.1 * normal(generator);
+		state.velocity.row(i) << -state.position(i, 1), state.position(i, 0), 0;
+	}
+	state.mass.setConstant(1. / bodyCount);
+	// dense enough that most bodies overlap several neighbours
+	state.radius.setConstant(std::cbrt(1. / bodyCount));
+	state.texture.setZero();
+	return state;
+}
+
+static void benchmarkIcosphere(BenchmarkRunner & runner)
+{
+	for(int level = 1; level <= 8; ++level)
+	{
+		// the previous level as input, copied untimed since subdivision replaces the indices
+		std::vector<float> baseVertices, vertices;
+		std::vector<unsigned> baseIndices, indices;
+		createIcosahedron(baseVertices, baseIndices);
+		for(int l = 1; l < level; ++l)
+			subdivideIcosphere(baseVertices, baseIndices);
+
+		runner.run("subdivideIcosphere", QJsonObject{{"level", level}}, [&] {
+			subdivideIcosphere(vertices, indices);
+			return static_cast<double>(vertices.size());
+		}, 1, [&] {
+			vertices = baseVertices;
+			indices = baseIndices;
+		});
+	}
+
+	for(int level : {4, 6})
+	{
+		std::vector<float> vertices;
+		std::vector<unsigned> baseIndices, indices;
+		createIcosahedron(vertices, baseIndices);
+		for(int l = 1; l <= level; ++l)
+			subdivideIcosphere(vertices, baseIndices);
+
+		runner.run("optimizeVertexCache", QJsonObject{{"level", level}}, [&] {
+			optimizeVertexCache(indices.data(), indices.size(), vertices.size() / 3);
+			return static_cast<double>(indices[0]);
+		}, 1, [&] {
+			indices = baseIndices;
+		});
+	}
+
+	runner.run("createIcosphereLevels", QJsonObject{{"maximumLevel", 6}}, [] {
+		return static_cast<double>(createIcosphereLevels(6).vertices.size());
+	});
+}
+
+static void benchmarkCamera(BenchmarkRunner & runner)
+{
+	auto azimuth = 0.;
+	runner.run("calculateLookAtMatrix", {}, [&] {
+		azimuth += 1e-3;
+		return calculateLookAtMatrix({std::cos(azimuth), std::sin(azimuth), 1}, {0, 0, 0}, {0, 0, 1})(0, 0);
+	}, 10000);
+
+	auto aspect = 1.;
+	runner.run("calculateInfinitePerspective", {}, [&] {
+		aspect += 1e-6;
+		return calculateInfinitePerspective(0.78539816339744831, aspect, 0.01)(0, 0);
+	}, 10000);
+
+	runner.run("calculateOrbitRotation", {}, [&] {
+		azimuth += 1e-3;
+		return calculateOrbitRotation(azimuth, 1.).matrix()(0, 0);
+	}, 10000);
+
+	// what ExampleRenderer::render does before drawing: move the camera and the bodies, update the scene graph,
+	// rebuild view, projection and frustum and cull every body
+	for(Eigen::Index bodyCount : {1000, 100000})
+	{
+		auto state = createBlob(bodyCount, 1);
+		SceneGraph scene;
+		auto pivot = scene.addNode(SceneGraph::root);
+		auto camera = scene.addNode(pivot, Eigen::Affine3d{Eigen::Translation3d{0, 0, 4}});
+		std::vector<SceneGraph::Node> bodies;
+		for(Eigen::Index i = 0; i < bodyCount; ++i)
+			bodies.push_back(scene.addNode(SceneGraph::root, Eigen::Affine3d::Identity(), 1));
+		auto projection = calculateInfinitePerspective(0.78539816339744831, 16. / 9, 0.01);
+
+		runner.run("frame transforms", QJsonObject{{"bodies", static_cast<int>(bodyCount)}}, [&] {
+			azimuth += 1e-3;
+			scene.setLocalTransform(pivot, calculateOrbitRotation(azimuth, 1.));
+			parallelFor(0, bodyCount, 4096, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+				for(auto i = first; i < last; ++i)
+				{
+					Eigen::Vector3d center = state.position.row(i).transpose();
+					scene.setLocalTransform(bodies[i], Eigen::Translation3d{center} * Eigen::Scaling(state.radius(i)));
+				}
+			});
+			scene.update();
+
+			Eigen::Matrix4d view = scene.worldTransform(camera).inverse(Eigen::Isometry).matrix();
+			Eigen::Matrix4d viewProjection = projection * view;
+			Frustum frustum{viewProjection};
+			std::atomic<int> visible{0};
+			parallelFor(0, bodyCount, 4096, [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+				auto count = 0;
+				for(auto i = first; i < last; ++i)
+					count += frustum.intersects(scene.worldBounds(bodies[i]));
+				visible += count;
+			});
+			return static_cast<double>(visible) + viewProjection(0, 0);
+		});
+	}
+}
+
+// a solid color has to come out of every level unchanged, a channel swap in the mip chain shows up here
+static bool checkTextureLevels()
+{
+	unsigned char const color[4] = {200, 120, 40, 255};
+	QImage image{64, 32, QImage::Format_RGBA8888};
+	image.fill(QColor{color[0], color[1], color[2], color[3]});
+
+	auto rgba = createTextureLevels(image, TextureLevels::Format::RGBA8);
+	auto data = reinterpret_cast<unsigned char const *>(rgba.data.constData());
+	for(auto const & level : rgba.levels)
+		for(std::size_t texel = 0; texel < level.size; texel += 4)
+			if(std::memcmp(data + level.offset + texel, color, 4) != 0)
+				return false;
+
+	unsigned char texels[64], block[8];
+	for(int i = 0; i < 16; ++i)
+		std::memcpy(texels + 4 * i, color, 4);
+	compressBC1Block(texels, block);
+
+	auto bc1 = createTextureLevels(image, TextureLevels::Format::BC1);
+	data = reinterpret_cast<unsigned char const *>(bc1.data.constData());
+	for(auto const & level : bc1.levels)
+		for(std::size_t offset = 0; offset < level.size; offset += 8)
+			if(std::memcmp(data + level.offset + offset, block, 8) != 0)
+				return false;
+	return true;
+}
+
+static void benchmarkTextures(BenchmarkRunner & runner)
+{
+	// smooth gradients with some noise, compressing flat colors would be unrealistically fast
+	QImage image{2048, 1024, QImage::Format_RGB32};
+	std::mt19937 generator{7};
+	std::uniform_int_distribution<int> noise{0, 15};
+	for(int y = 0; y < image.height(); ++y)
+	{
+		auto line = reinterpret_cast<QRgb *>(image.scanLine(y));
+		for(int x = 0; x < image.width(); ++x)
+			line[x] = qRgb((x / 8 + noise(generator)) & 0xff, (y / 4 + noise(generator)) & 0xff, ((x + y) / 16 + noise(generator)) & 0xff);
+	}
+	QJsonObject size{{"width", image.width()}, {"height", image.height()}};
+
+	runner.run("QImage::mirrored", size, [&] {
+		return static_cast<double>(image.mirrored().width());
+	});
+
+	runner.run("QImage::convertToFormat", size, [&] {
+		return static_cast<double>(image.convertToFormat(QImage::Format_RGBA8888).width());
+	});
+
+	auto rgba = size;
+	rgba["format"] = "RGBA8";
+	runner.run("createTextureLevels", rgba, [&] {
+		return static_cast<double>(createTextureLevels(image, TextureLevels::Format::RGBA8).data.size());
+	});
+
+	auto bc1 = size;
+	bc1["format"] = "BC1";
+	runner.run("createTextureLevels", bc1, [&] {
+		return static_cast<double>(createTextureLevels(image, TextureLevels::Format::BC1).data.size());
+	});
+
+	auto texels = image.convertToFormat(QImage::Format_RGBA8888);
+	// walks along the top block row so the texels differ between calls
+	auto blockX = 0;
+	runner.run("compressBC1Block", {}, [&] {
+		blockX = (blockX + 4) % texels.width();
+		unsigned char data[64], block[8];
+		for(int row = 0; row < 4; ++row)
+			std::memcpy(data + 16 * row, texels.constScanLine(row) + 4 * blockX, 16);
+		compressBC1Block(data, block);
+		return static_cast<double>(block[0]);
+	}, 10000);
+}
+
+static void benchmarkPhysics(BenchmarkRunner & runner)
+{
+	for(Eigen::Index bodyCount : {1000, 4000})
+	{
+		auto state = createBlob(bodyCount, 2);
+		Eigen::ArrayX3d acceleration(bodyCount, 3);
+		AllPairsGravity gravity{1, 1e-3};
+		runner.run("AllPairsGravity", QJsonObject{{"bodies", static_cast<int>(bodyCount)}}, [&] {
+			gravity.computeAccelerations(state.position, state.mass, acceleration);
+			return acceleration(0, 0);
+		});
+	}
+
+	for(Eigen::Index bodyCount : {10000, 100000})
+	{
+		auto state = createBlob(bodyCount, 3);
+		Eigen::ArrayX3d acceleration(bodyCount, 3);
+		BarnesHutGravity gravity{1, 1e-3, 0.5};
+		runner.run("BarnesHutGravity", QJsonObject{{"bodies", static_cast<int>(bodyCount)}, {"openingAngle", 0.5}}, [&] {
+			gravity.computeAccelerations(state.position, state.mass, acceleration);
+			return acceleration(0, 0);
+		});
+	}
+
+	// the integrators' own arithmetic and bookkeeping, with a cheap force so the gravity solver does not dominate
+	{
+		Eigen::Index bodyCount = 100000;
+		auto initial = createBlob(bodyCount, 4);
+		for(auto const & name : integratorNames())
+		{
+			auto integrator = createIntegrator(name);
+			auto state = initial;
+			runner.run("Integrator::step", QJsonObject{{"integrator", QString::fromStdString(name)}, {"bodies", static_cast<int>(bodyCount)}}, [&] {
+				integrator->step(state, 1e-3, [] (Eigen::ArrayX3d const & position, Eigen::ArrayX3d & acceleration) {
+					acceleration = -position;
+				});
+				return state.position(0, 0);
+			});
+		}
+	}
+
+	for(Eigen::Index bodyCount : {10000, 100000})
+	{
+		auto state = createBlob(bodyCount, 5);
+		CollisionSolver collisions;
+		runner.run("CollisionSolver::findContacts", QJsonObject{{"bodies", static_cast<int>(bodyCount)}}, [&] {
+			return static_cast<double>(collisions.findContacts(state.position, state.radius).size());
+		});
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	QCoreApplication app{argc, argv};
+	QCoreApplication::setApplicationName("SimulationFrameworkBench");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QCoreApplication::translate("main", "Micro-benchmarks of the CPU hot paths of the simulation framework, printed as JSON."));
+	parser.addHelpOption();
+
+	QCommandLineOption filterOption("filter", QCoreApplication::translate("main", "Only run benchmarks whose name contains <text>"), QCoreApplication::translate("main", "text"));
+	parser.addOption(filterOption);
+
+	QCommandLineOption minimumTimeOption("min-time", QCoreApplication::translate("main", "Keep sampling every benchmark for at least <seconds>"), QCoreApplication::translate("main", "seconds"), "0.5");
+	parser.addOption(minimumTimeOption);
+
+	QCommandLineOption outputOption("output", QCoreApplication::translate("main", "Write the JSON to <file> instead of the standard output"), QCoreApplication::translate("main", "file"));
+	parser.addOption(outputOption);
+
+	parser.process(app);
+
+	auto minimumTimeValid = false;
+	auto minimumTime = parser.value(minimumTimeOption).toDouble(&minimumTimeValid);
+	if(!minimumTimeValid || minimumTime < 0)
+	{
+		QTextStream{stderr} << QCoreApplication::translate("main", "Invalid minimum time: %1").arg(parser.value(minimumTimeOption)) << '\n';
+		return 1;
+	}
+
+	// timing broken output is pointless
+	if(!checkTextureLevels())
+	{
+		QTextStream{stderr} << QCoreApplication::translate("main", "createTextureLevels changes the color of a solid image") << '\n';
+		return 1;
+	}
+
+	BenchmarkRunner runner{minimumTime, parser.value(filterOption)};
+	benchmarkIcosphere(runner);
+	benchmarkCamera(runner);
+	benchmarkTextures(runner);
+	benchmarkPhysics(runner);
+
+	QJsonObject report;
+	report["threads"] = static_cast<int>(workerCount());
+#ifdef NDEBUG
+	report["assertions"] = false;
+#else
+	report["assertions"] = true;
+#endif
+	report["benchmarks"] = runner.benchmarks();
+	auto json = QJsonDocument{report}.toJson();
+
+	if(!parser.isSet(outputOption))
+	{
+		QTextStream{stdout} << json;
+		return 0;
+	}
+
+	QFile file{parser.value(outputOption)};
+	if(!file.open(QIODevice::WriteOnly) || file.write(json) != json.size())
+	{
+		QTextStream{stderr} << QCoreApplication::translate("main", "Could not write %1").arg(file.fileName()) << '\n';
+		return 1;
+	}
+	return 0;
+}
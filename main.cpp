@@ -1,14 +1,67 @@
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QSurfaceFormat>
+#include <QTextStream>
 
 #include "GLMainWindow.hpp"
 #include "ExampleRenderer.hpp"
+#include "BarnesHut.hpp"
+#include "BatchRunner.hpp"
+#include "Benchmark.hpp"
+#include "FrameScheduler.hpp"
+#include "Integrators.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+#include <memory>
+#include <random>
+
+// prints the accuracy and cost of Barnes-Hut for several opening angles relative to the exact all-pairs sum
+static int compareGravity(int bodyCount)
+{
+	std::mt19937 generator{42};
+	std::normal_distribution<double> normal;
+
+	// a flattened gaussian blob, roughly the density contrast of a disc galaxy
+	Eigen::ArrayX3d position(bodyCount, 3);
+	for(Eigen::Index i = 0; i < bodyCount; ++i)
+		position.row(i) << normal(generator), normal(generator), 0.1 * normal(generator);
+	Eigen::ArrayXd mass = Eigen::ArrayXd::Constant(bodyCount, 1. / bodyCount);
+
+	QTextStream out{stdout};
+	out << "theta\tall-pairs [ms]\tbarnes-hut [ms]\tspeedup\trms error\tmax error\n";
+
+	AllPairsGravity exact{1, 1e-3};
+	for(auto theta : {0.2, 0.3, 0.5, 0.7, 1.0})
+	{
+		BarnesHutGravity approximate{1, 1e-3, theta};
+		auto result = compareGravitySolvers(exact, approximate, position, mass);
+		out << theta << '\t'
+			<< 1e3 * result.referenceSeconds << '\t'
+			<< 1e3 * result.candidateSeconds << '\t'
+			<< result.referenceSeconds / result.candidateSeconds << '\t'
+			<< result.rmsRelativeError << '\t'
+			<< result.maximumRelativeError << '\n';
+	}
+	return 0;
+}
 
 int main(int argc, char ** argv)
 {
+	// the platform plugin is chosen when the application is constructed, so the benchmark and batch options have to be spotted before the parser runs
+	auto batch = false;
+	for(int i = 1; i < argc; ++i)
+	{
+		if((std::strcmp(argv[i], "--benchmark") == 0 || std::strncmp(argv[i], "--benchmark=", 12) == 0) && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+			qputenv("QT_QPA_PLATFORM", "offscreen");
+		if(std::strcmp(argv[i], "--batch") == 0 || std::strncmp(argv[i], "--batch=", 8) == 0)
+			batch = true;
+	}
+
+	// batch runs need no windowing system at all, so they run on compute nodes without a display
 	using App = QApplication;
-	App app(argc, argv);
+	std::unique_ptr<QCoreApplication> app{batch ? new QCoreApplication(argc, argv) : new App(argc, argv)};
+	Profiler::setThreadName("main");
 	App::setApplicationName("SimulationFramework");
 	App::setApplicationDisplayName(App::translate("main", "Simulation Framework"));
 	App::setApplicationVersion("1.0");
@@ -21,7 +74,136 @@ int main(int argc, char ** argv)
 	QCommandLineOption debugGLOption({ "g", "debug-gl" }, App::translate("main", "Enable OpenGL debug logging"));
 	parser.addOption(debugGLOption);
 
-	parser.process(app);
+	QCommandLineOption compareGravityOption("compare-gravity", App::translate("main", "Compare Barnes-Hut against the exact all-pairs gravity for <bodies> bodies and exit"), App::translate("main", "bodies"));
+	parser.addOption(compareGravityOption);
+
+	QStringList integrators;
+	for(auto const & name : integratorNames())
+		integrators << QString::fromStdString(name);
+	QCommandLineOption integratorOption("integrator", App::translate("main", "Time integration scheme, one of %1").arg(integrators.join(", ")), App::translate("main", "name"), QString::fromStdString(ExampleRendererSettings().integrator));
+	parser.addOption(integratorOption);
+
+	FrameScheduler::Mode frameMode = FrameScheduler::Mode::OnDemand;
+	QCommandLineOption frameModeOption("frame-mode", App::translate("main", "When frames are drawn: continuous, paced (at the frame rate cap) or on-demand (on input and simulation updates)"), App::translate("main", "mode"), FrameScheduler::modeName(frameMode));
+	parser.addOption(frameModeOption);
+
+	QCommandLineOption renderThreadOption("render-thread", App::translate("main", "Render on a dedicated thread into a native window instead of on the GUI thread"));
+	parser.addOption(renderThreadOption);
+
+	QCommandLineOption frameRateCapOption("frame-rate-cap", App::translate("main", "Upper bound on frames per second for the paced and on-demand modes, 0 for none"), App::translate("main", "fps"), "60");
+	parser.addOption(frameRateCapOption);
+
+	QCommandLineOption recordOption("record", App::translate("main", "Record every simulation step to <file>"), App::translate("main", "file"));
+	parser.addOption(recordOption);
+
+	QCommandLineOption replayOption("replay", App::translate("main", "Play back a recording made with --record instead of simulating"), App::translate("main", "file"));
+	parser.addOption(replayOption);
+
+	QCommandLineOption bodyRendererOption("body-renderer", App::translate("main", "How bodies are drawn: mesh (instanced icospheres) or impostor (ray cast quads)"), App::translate("main", "renderer"), "mesh");
+	parser.addOption(bodyRendererOption);
+
+	QCommandLineOption shaderDirectoryOption("shader-dir", App::translate("main", "Read shaders from <directory> where it has them instead of the built-in resources and reload them when they change"), App::translate("main", "directory"));
+	parser.addOption(shaderDirectoryOption);
+
+	QCommandLineOption particlesOption("particles", App::translate("main", "Simulate an asteroid belt of <count> particles on the GPU"), App::translate("main", "count"), "0");
+	parser.addOption(particlesOption);
+
+	QCommandLineOption benchmarkOption("benchmark", App::translate("main", "Render <frames> frames without a window, print frame time statistics as JSON and exit (uses the offscreen platform unless QT_QPA_PLATFORM is set)"), App::translate("main", "frames"));
+	parser.addOption(benchmarkOption);
+
+	QCommandLineOption resolutionOption("resolution", App::translate("main", "Framebuffer size for --benchmark"), App::translate("main", "WxH"), "1280x720");
+	parser.addOption(resolutionOption);
+
+	QCommandLineOption batchOption("batch", App::translate("main", "Run the ensemble described by the JSON <scenario> on all cores without a window, write one CSV row of results per run and exit"), App::translate("main", "scenario"));
+	parser.addOption(batchOption);
+
+	QCommandLineOption outputOption("output", App::translate("main", "Write the --batch results to <file> instead of the standard output"), App::translate("main", "file"));
+	parser.addOption(outputOption);
+
+	parser.process(*app);
+
+	if(!integrators.contains(parser.value(integratorOption)))
+	{
+		QTextStream{stderr} << App::translate("main", "Unknown integrator: %1").arg(parser.value(integratorOption)) << '\n';
+		return 1;
+	}
+
+	if(!FrameScheduler::parseMode(parser.value(frameModeOption), frameMode))
+	{
+		QTextStream{stderr} << App::translate("main", "Unknown frame mode: %1").arg(parser.value(frameModeOption)) << '\n';
+		return 1;
+	}
+
+	auto frameRateCapValid = false;
+	auto frameRateCap = parser.value(frameRateCapOption).toDouble(&frameRateCapValid);
+	if(!frameRateCapValid || frameRateCap < 0)
+	{
+		QTextStream{stderr} << App::translate("main", "Invalid frame rate cap: %1").arg(parser.value(frameRateCapOption)) << '\n';
+		return 1;
+	}
+
+	auto bodyRenderer = ExampleRendererSettings::BodyRenderer::Mesh;
+	if(parser.value(bodyRendererOption) == "impostor")
+		bodyRenderer = ExampleRendererSettings::BodyRenderer::Impostor;
+	else if(parser.value(bodyRendererOption) != "mesh")
+	{
+		QTextStream{stderr} << App::translate("main", "Unknown body renderer: %1").arg(parser.value(bodyRendererOption)) << '\n';
+		return 1;
+	}
+
+	auto particleCountValid = false;
+	auto particleCount = parser.value(particlesOption).toUInt(&particleCountValid);
+	if(!particleCountValid)
+	{
+		QTextStream{stderr} << App::translate("main", "Invalid particle count: %1").arg(parser.value(particlesOption)) << '\n';
+		return 1;
+	}
+
+	if(parser.isSet(compareGravityOption))
+	{
+		auto bodyCountValid = false;
+		auto bodyCount = parser.value(compareGravityOption).toInt(&bodyCountValid);
+		if(!bodyCountValid || bodyCount <= 0)
+		{
+			QTextStream{stderr} << App::translate("main", "Invalid body count: %1").arg(parser.value(compareGravityOption)) << '\n';
+			return 1;
+		}
+		return compareGravity(bodyCount);
+	}
+
+	if(parser.isSet(batchOption))
+	{
+		// the scenario names its integrator, --integrator only fills in when it does not
+		BatchScenario scenario;
+		scenario.integrator = parser.value(integratorOption).toStdString();
+		QString error;
+		if(!loadBatchScenario(parser.value(batchOption), scenario, error))
+		{
+			QTextStream{stderr} << error << '\n';
+			return 1;
+		}
+		return runBatch(scenario, parser.value(outputOption));
+	}
+
+	BenchmarkSettings benchmarkSettings;
+	if(parser.isSet(benchmarkOption))
+	{
+		auto resolution = parser.value(resolutionOption).split('x');
+		auto widthValid = false, heightValid = false, framesValid = false;
+		if(resolution.size() == 2)
+			benchmarkSettings.resolution = {resolution[0].toInt(&widthValid), resolution[1].toInt(&heightValid)};
+		benchmarkSettings.frames = parser.value(benchmarkOption).toInt(&framesValid);
+		if(!widthValid || !heightValid || benchmarkSettings.resolution.isEmpty())
+		{
+			QTextStream{stderr} << App::translate("main", "Invalid resolution: %1").arg(parser.value(resolutionOption)) << '\n';
+			return 1;
+		}
+		if(!framesValid || benchmarkSettings.frames <= 0)
+		{
+			QTextStream{stderr} << App::translate("main", "Invalid frame count: %1").arg(parser.value(benchmarkOption)) << '\n';
+			return 1;
+		}
+	}
 
 	auto surfaceFormat = QSurfaceFormat::defaultFormat();
 	surfaceFormat.setVersion(3, 3);
@@ -29,19 +211,32 @@ int main(int argc, char ** argv)
 	surfaceFormat.setOption(QSurfaceFormat::DebugContext);
 	QSurfaceFormat::setDefaultFormat(surfaceFormat);
 
-	GLMainWindow widget;
+	ExampleRendererSettings settings;
+	settings.integrator = parser.value(integratorOption).toStdString();
+	settings.recordPath = parser.value(recordOption).toStdString();
+	settings.replayPath = parser.value(replayOption).toStdString();
+	settings.bodyRenderer = bodyRenderer;
+	settings.shaderDirectory = parser.value(shaderDirectoryOption).toStdString();
+	settings.particleCount = particleCount;
+
+	auto rendererFactory = [settings] (QObject * parent) {
+		return new ExampleRenderer{parent, settings};
+	};
+
+	if(parser.isSet(benchmarkOption))
+		return runBenchmark(rendererFactory, benchmarkSettings);
+
+	GLMainWindow widget{parser.isSet(renderThreadOption) ? GLMainWindow::RenderHost::Thread : GLMainWindow::RenderHost::Widget};
 	if(parser.isSet(debugGLOption))
 	{
 		widget.setOpenGLLoggingSynchronous(true);
 		widget.setOpenGLLoggingEnabled(true);
 	}
 
-	widget.setRendererFactory(
-		[] (QObject * parent) {
-			return new ExampleRenderer{parent};
-		}
-	);
+	widget.setFrameMode(frameMode);
+	widget.setFrameRateCap(frameRateCap);
+	widget.setRendererFactory(rendererFactory);
 	widget.show();
 
-	return app.exec();
+	return app->exec();
 }
@@ -0,0 +1,32 @@
+#version 330
+
+uniform sampler2DArray colorTextures;
+
+in vec3 direction;
+flat in float textureLayer;
+
+out vec4 color;
+
+const float pi = 3.14159265358979323846;
+
+const vec4 placeholderColor = vec4(0.5, 0.5, 0.5, 1);
+
+void main()
+{
+	// the texture of this layer is still being loaded
+	if(textureLayer < 0)
+	{
+		color = placeholderColor;
+		return;
+	}
+
+	vec3 n = normalize(direction);
+
+	// equirectangular mapping around the z axis, the second longitude avoids the mip seam where atan wraps (Tarini 2011)
+	float u0 = atan(n.y, n.x) / (2 * pi) + 0.5;
+	float u1 = fract(u0 + 0.5) - 0.5;
+	float u = fwidth(u0) <= fwidth(u1) ? u0 : u1;
+	float v = acos(clamp(n.z, -1, 1)) / pi;
+
+	color = texture(colorTextures, vec3(u, v, textureLayer));
+}
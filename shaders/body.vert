@@ -0,0 +1,29 @@
+#version 330
+
+// octahedral encoded position on the unit sphere, see encodeOctahedral
+layout(location = 0) in ivec2 octahedral;
+// per instance: center and radius, texture array layer
+layout(location = 1) in vec4 sphere;
+layout(location = 2) in float layer;
+
+uniform mat4 viewProjection;
+
+out vec3 direction;
+flat out float textureLayer;
+
+vec3 decodeOctahedral(ivec2 encoded)
+{
+	vec2 e = vec2(encoded) / 32767.0;
+	vec3 n = vec3(e, 1 - abs(e.x) - abs(e.y));
+	if(n.z < 0)
+		n.xy = (1 - abs(n.yx)) * mix(vec2(-1), vec2(1), greaterThanEqual(n.xy, vec2(0)));
+	return normalize(n);
+}
+
+void main()
+{
+	vec3 position = decodeOctahedral(octahedral);
+	direction = position;
+	textureLayer = layer;
+	gl_Position = viewProjection * vec4(sphere.xyz + sphere.w * position, 1);
+}
@@ -0,0 +1,48 @@
+#version 330
+
+uniform sampler2DArray colorTextures;
+uniform mat4 projection;
+// turns view space directions back into world space
+uniform mat3 inverseViewRotation;
+
+in vec3 viewPosition;
+flat in vec3 sphereCenter;
+flat in float sphereRadius;
+flat in float textureLayer;
+
+out vec4 color;
+
+const float pi = 3.14159265358979323846;
+
+const vec4 placeholderColor = vec4(0.5, 0.5, 0.5, 1);
+
+void main()
+{
+	// the eye is the origin of view space, take the nearer intersection of its ray with the sphere
+	vec3 ray = normalize(viewPosition);
+	float b = dot(ray, sphereCenter);
+	float discriminant = b * b - dot(sphereCenter, sphereCenter) + sphereRadius * sphereRadius;
+	if(discriminant < 0)
+		discard;
+	vec3 hit = (b - sqrt(discriminant)) * ray;
+
+	vec4 clip = projection * vec4(hit, 1);
+	gl_FragDepth = 0.5 * clip.z / clip.w + 0.5;
+
+	// the texture of this layer is still being loaded
+	if(textureLayer < 0)
+	{
+		color = placeholderColor;
+		return;
+	}
+
+	vec3 n = inverseViewRotation * ((hit - sphereCenter) / sphereRadius);
+
+	// the mapping of body.frag
+	float u0 = atan(n.y, n.x) / (2 * pi) + 0.5;
+	float u1 = fract(u0 + 0.5) - 0.5;
+	float u = fwidth(u0) <= fwidth(u1) ? u0 : u1;
+	float v = acos(clamp(n.z, -1, 1)) / pi;
+
+	color = texture(colorTextures, vec3(u, v, textureLayer));
+}
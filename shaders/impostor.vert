@@ -0,0 +1,46 @@
+#version 330
+
+// corner of the quad in [-1, 1]^2
+layout(location = 0) in vec2 corner;
+// per instance: center and radius, texture array layer
+layout(location = 1) in vec4 sphere;
+layout(location = 2) in float layer;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 viewPosition;
+flat out vec3 sphereCenter;
+flat out float sphereRadius;
+flat out float textureLayer;
+
+void main()
+{
+	vec3 center = (view * vec4(sphere.xyz, 1)).xyz;
+	float radius = sphere.w;
+	float distance = length(center);
+
+	sphereCenter = center;
+	sphereRadius = radius;
+	textureLayer = layer;
+
+	// from inside the sphere only back faces would be visible, the meshes cull those as well
+	if(distance <= radius)
+	{
+		viewPosition = vec3(0);
+		gl_Position = vec4(0, 0, 0, 1);
+		return;
+	}
+
+	// a quad through the center facing the eye, just large enough to cover the cone of rays touching the sphere
+	vec3 forward = center / distance;
+	vec3 right = cross(forward, vec3(0, 1, 0));
+	if(dot(right, right) < 1e-6)
+		right = cross(forward, vec3(1, 0, 0));
+	right = normalize(right);
+	vec3 up = cross(right, forward);
+	float halfSize = radius * distance / sqrt(distance * distance - radius * radius);
+
+	viewPosition = center + halfSize * (corner.x * right + corner.y * up);
+	gl_Position = projection * vec4(viewPosition, 1);
+}
@@ -0,0 +1,17 @@
+#version 330
+
+in float brightness;
+
+out vec4 color;
+
+const vec3 rockColor = vec3(0.55, 0.5, 0.45);
+
+void main()
+{
+	// round sprites
+	vec2 p = 2 * gl_PointCoord - 1;
+	if(dot(p, p) > 1)
+		discard;
+
+	color = vec4(brightness * rockColor, 1);
+}
@@ -0,0 +1,19 @@
+#version 330
+
+layout(location = 0) in vec3 position;
+
+uniform mat4 viewProjection;
+uniform float pixelScale;
+
+out float brightness;
+
+const float particleSize = 0.004;
+
+void main()
+{
+	gl_Position = viewProjection * vec4(position, 1);
+	// at least one pixel, so distant particles do not flicker in and out
+	gl_PointSize = max(particleSize * pixelScale / gl_Position.w, 1);
+	// a stable per particle variation, there is no attribute for it
+	brightness = 0.6 + 0.4 * fract(sin(float(gl_VertexID) * 12.9898) * 43758.5453);
+}
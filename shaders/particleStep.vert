@@ -0,0 +1,30 @@
+#version 330
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 velocity;
+
+// xyz position and w mass of the bodies that attract the particles
+uniform vec4 attractors[16];
+uniform int attractorCount;
+uniform float timeStep;
+
+out vec3 outPosition;
+out vec3 outVelocity;
+
+// the softening of the body gravity, squared
+const float softening2 = 1e-4;
+
+void main()
+{
+	vec3 acceleration = vec3(0);
+	for(int i = 0; i < attractorCount; ++i)
+	{
+		vec3 d = attractors[i].xyz - position;
+		float r2 = dot(d, d) + softening2;
+		acceleration += attractors[i].w * inversesqrt(r2 * r2 * r2) * d;
+	}
+
+	// semi-implicit euler is symplectic, the belt keeps its shape instead of slowly spiralling outward
+	outVelocity = velocity + timeStep * acceleration;
+	outPosition = position + timeStep * outVelocity;
+}